@@ -1,28 +1,66 @@
+#include "FuncExtract.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Pass.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Analysis/RegionPass.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/Analysis/DominanceFrontier.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/CaptureTracking.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/Dominators.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/ValueSymbolTable.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/GlobPattern.h"
+#include "llvm/Support/LineIterator.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Regex.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/SCCIterator.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/StringMap.h"
-#include "llvm/ADT/StringSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/IR/DebugInfoMetadata.h"
-#include "llvm/Transforms/Utils/Local.h"
-#include <fstream>
 #include <sstream>
 #include <vector>
 #include <deque>
 #include <string>
 #include <limits>
 #include <algorithm>
+#include <iterator>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <tuple>
 
 using namespace llvm;
 
+#define DEBUG_TYPE "funcextract"
+
+STATISTIC(NumSliceVisited, "Number of values visited while slicing instructions");
+STATISTIC(NumSliceQueries, "Number of instruction slice queries");
+STATISTIC(NumSliceHits,    "Number of instruction slice queries answered from cache");
+STATISTIC(NumRecordHits,   "Number of region records read from on-disk cache");
+
 static cl::opt<std::string> BBListFilename("bblist", 
 	   		cl::desc("List of blocks' labels that are to be extracted. Must form a valid region."), 
 	   		cl::value_desc("filename"), cl::Required  );
@@ -31,101 +69,621 @@ static cl::opt<std::string> OutDirectory("out",
 	   		cl::desc("Name of the file to info to."), 
 	   		cl::value_desc("outputdirectory"), cl::Required  );
 
+static cl::opt<bool> NoSliceCache("funcextract-no-slice-cache", 
+			cl::desc("Walk operand chain of every instruction from scratch instead of using per-function cache."), 
+			cl::init(false));
+
+enum DetectionEngine { ScanEngine, UsesEngine, SummaryEngine };
+static cl::opt<DetectionEngine> Engine("funcextract-engine", 
+			cl::desc("Strategy used for detecting region inputs / outputs."),
+			cl::values(clEnumValN(ScanEngine, "scan", "Slice every region / successor instruction (default)."),
+					   clEnumValN(UsesEngine, "uses", "Walk use lists of candidate variables."),
+					   clEnumValN(SummaryEngine, "summary", "Compose per-region summaries bottom-up over the region tree.")),
+			cl::init(ScanEngine));
+
+static cl::opt<bool> AllRegions("funcextract-all-regions", 
+			cl::desc("Write info for every region of every function, ignoring the region list."), 
+			cl::init(false));
+
+static cl::opt<unsigned> Threads("funcextract-threads", 
+			cl::desc("Number of threads analysing regions. Only used by -funcextract-module, 0 means one per core."), 
+			cl::init(1));
+
+enum OutputFormat { XMLFormat, JSONFormat, BinaryFormat };
+static cl::opt<OutputFormat> Format("funcextract-format", 
+			cl::desc("Format of written region info."),
+			cl::values(clEnumValN(XMLFormat, "xml", "XML-like, understood by extractor script (default)."),
+					   clEnumValN(JSONFormat, "jsonl", "One JSON object per line."),
+					   clEnumValN(BinaryFormat, "binary", "Compact binary format with a string table.")),
+			cl::init(XMLFormat));
+
+static cl::opt<bool> Aggregate("funcextract-aggregate", 
+			cl::desc("Append all region records to a single file given by -out. Implied by -out=-, which writes to stdout."), 
+			cl::init(false));
+
+static cl::opt<std::string> CacheDirectory("funcextract-cache", 
+			cl::desc("Directory with cached region records. Regions of functions that did not change are not analysed again."), 
+			cl::value_desc("directory"), cl::init(""));
+
+static cl::opt<std::string> Shard("funcextract-shard", 
+			cl::desc("Only process regions of shard i out of N, given as i/N. Regions are assigned to shards by a stable hash."), 
+			cl::value_desc("i/N"), cl::init(""));
+
+static cl::opt<bool> Liveness("funcextract-liveness", 
+			cl::desc("Prune inputs / outputs using live variable analysis of local variables."), 
+			cl::init(false));
+
 namespace {
-	typedef std::pair<unsigned,unsigned> AreaLoc;
-	typedef std::pair<Value *, Value *>  ValuePair;
-
-	struct VariableInfo { 
-		std::string name; 
-		std::string type; 
-		bool typehasname;  // sometimes we need to include variable name into the type definition.
-		bool isfunptr; 
-		bool isconstq; 
-		bool isstatic; 
-		bool isarrayt;
+	using funcextract::AreaLoc;
+	using funcextract::VariableInfo;
+	using funcextract::RegionRecord;
+	typedef DenseMap<Value *, SmallVector<Value *, 2>> ConstantIndex;
+
+	// right hand side of a region list line, see RegionListIndex::read.
+	struct RegionSelector {
+		enum Kind { BlockNames, LineRange, EveryRegion } kind;
+		std::string entry; // block names, exit is <FunctionReturn> for regions ending in return.
+		std::string exit;
+		AreaLoc lines;
+	};
+
+	// region list compiled into an index by function. Exact function names, which is what 
+	// generated lists mostly consist of, take a single hash lookup. Globs, regular expressions
+	// and source files are expected to be few and are tried one by one.
+	struct RegionListIndex {
+		bool everything = false;
+		StringMap<std::vector<RegionSelector>> functions;
+		std::vector<std::pair<GlobPattern, RegionSelector>> globs;
+		std::vector<std::pair<std::unique_ptr<Regex>, RegionSelector>> regexes;
+		StringMap<std::vector<std::pair<std::string, RegionSelector>>> files; // keyed by file name without directories.
+
+		void read(const std::string&);
+		void getSelectors(const Function&, std::vector<const RegionSelector *>&) const;
+		bool isListed(const Function& F) const;
+	};
+
+	// source lines of function's blocks sorted by first line, blocks without any line are left out. 
+	// maxend[i] is the last line of blocks 0..i, so looking for blocks overlapping a range can
+	// go backwards from the binary search result and stop once maxend is before the range.
+	struct BlockLineIndex {
+		std::vector<std::pair<AreaLoc, BasicBlock *>> blocks;
+		std::vector<unsigned> maxend;
+
+		void reset(Function *);
+		void find(const AreaLoc&, SmallVectorImpl<BasicBlock *>&) const;
+	};
+
+	// region as seen by the analysis. Unlike Region it stays valid after region info of the
+	// function is gone, which lets us analyse regions of many functions at once.
+	struct RegionDesc {
+		BasicBlock *entry;
+		BasicBlock *exit;  // nullptr for top level region.
+		bool toplevel;
+		BitVector members; // indexed by block number.
+		BitVector uses;    // variables used inside the region, filled in by summary engine only.
+		std::pair<unsigned, unsigned> position; // see RegionRecord.
+		std::string cachekey; // empty if cache is disabled.
+		std::shared_ptr<RegionRecord> cached; // set if record has been found in cache.
+	};
+
+	// serializes region records. Records are written straight into a buffered stream, 
+	// so writers must not build any temporary strings per element.
+	struct RecordWriter {
+		virtual ~RecordWriter() { }
+		virtual const char *extension() const = 0;
+		virtual void write(const RegionRecord&, raw_ostream&) = 0;
+	};
+
+	struct XMLRecordWriter : public RecordWriter {
+		const char *extension() const override { return ".xml"; }
+		void write(const RegionRecord&, raw_ostream&) override;
+	};
+
+	struct JSONRecordWriter : public RecordWriter {
+		const char *extension() const override { return ".jsonl"; }
+		void write(const RegionRecord&, raw_ostream&) override;
+	};
+
+	// record layout, all integers are ULEB128 encoded: 
+	//   magic "FXR4", number of strings, strings as (length, bytes), 
+	//   funcname, returntype (string indexes), region start, end, function start, end, 
+	//   flags (toplevel, liveness, readnone, readonly, argmemonly), number of exits, exits, 
+	//   number of variables, variables as (name, type (string indexes), flags, size, align, 
+	//   pointer align, number of live exits, live exits).
+	struct BinaryRecordWriter : public RecordWriter {
+		// variable flags in the order of bits.
+		enum { TypeHasName = 1, IsFunPtr = 2, IsConstQ = 4, IsStatic = 8, 
+			   IsArrayT = 16, IsModified = 32, IsLocal = 64, IsOutput = 128, 
+			   IsRestrict = 256, IsNonNull = 512 };
+		DenseMap<StringRef, unsigned> index; // string ids of the current record, every record has its own table.
+		SmallVector<StringRef, 16> strings;
+
+		const char *extension() const override { return ".bin"; }
+		void write(const RegionRecord&, raw_ostream&) override;
+		unsigned intern(StringRef);
+	};
+
+	// C declarator of a debug info type with the variable name left out. The name goes between
+	// every two parts, so it is printed by joining the parts. Flags are those of getTypeString.
+	struct TypeDeclarator {
+		SmallVector<std::string, 2> parts;
+		bool typehasname = false;
+		bool isfunptr = false;
+		bool isconstq = false;
+		bool isarrayt = false;
+
+		std::string print(StringRef) const;
+	};
+
+	// declarators of types seen so far. Regions of different functions may be analysed on 
+	// several threads at once, entries are never removed or changed once added.
+	struct TypeCache {
+		std::mutex lock;
+		DenseMap<const DIType *, std::unique_ptr<TypeDeclarator>> types;
+	};
+
+	// answers debug info queries from a single per-module index instead of walking metadata uses 
+	// on every lookup. Globals are indexed once per module, locals are indexed function by 
+	// function as functions are visited. In optimized code locals have no alloca, instead every
+	// llvm.dbg.value binds an SSA value to the variable. Both the bound value (a read of the 
+	// variable) and the dbg.value itself (a write) are then mapped to the variable.
+	struct DebugInfoIndex {
+		Module *M = nullptr;
+		DenseMap<const Value *, DILocalVariable *> locals;
+		DenseMap<const GlobalVariable *, DIGlobalVariable *> globals;
+		DenseMap<const DISubprogram *, std::vector<GlobalVariable *>> statics; // function-local globals.
+		DenseSet<const Function *> indexed;
+		DenseMap<const Function *, unsigned> functions; // position in module.
+		mutable TypeCache types; // filled in by getTypeString.
+
+		void reset(Module *);
+		void indexFunction(Function *);
+		void forgetFunction(Function *);
+		const std::vector<GlobalVariable *>& getStatics(const Function *) const;
+		bool isStatic(const Function *, const GlobalVariable *) const;
+	};
+
+	// memoizes DFSInstruction results for a single function. Every instruction's set of 
+	// reachable allocas / globals is computed once and then shared by all regions of the function.
+	struct SliceCache {
+		Function *F = nullptr;
+		const DebugInfoIndex *DI = nullptr;
+		DenseMap<Value *, DenseSet<Value *>> slices;
+		DenseSet<Value *> scratch; // result storage when caching is disabled.
+
+		void reset(const DebugInfoIndex& NewDI, Function *NewF) { DI = &NewDI; F = NewF; slices.clear(); }
+		const DenseSet<Value *>& get(Value *);
+	};
+
+	// allocas and function-local globals of a single function, i.e. everything that may 
+	// become input / output of the region. Used by use-list-driven engine.
+	struct CandidateCache {
+		Function *F = nullptr;
+		std::vector<Value *> variables;
+		DenseMap<Value *, std::vector<BasicBlock *>> constantblocks; // magic number -> blocks of F using it.
+
+		void reset(const DebugInfoIndex&, const ConstantIndex&, Function *);
+	};
+
+	// shard of the regions to process, given by -funcextract-shard. Parsed before any region is
+	// visited, so nothing is initialised lazily once regions may be handled on several threads.
+	struct ShardSpec {
+		unsigned index = 0;
+		unsigned count = 1;
+	};
+
+	// memory an input gives the extracted function access to. Pointers and arrays, which decay to 
+	// pointers, reach the objects their values are based on, anything else reaches its own storage
+	// when passed by pointer. Objects are those of GetUnderlyingObjects.
+	struct InputTargets {
+		bool pointer = false;
+		bool complete = true;    // objects are everything the input reaches.
+		bool nonnull = true;     // every pointer value is known to be non-null.
+		unsigned align = 0;      // known alignment of every pointer value, 0 if unknown.
+		bool aligned = false;    // align has been set by some pointer value.
+		Value *storage = nullptr;
+		Type *pointee = nullptr; // what pointer values point to in IR.
+		SmallPtrSet<const Value *, 4> objects;
+	};
+
+	// live variable analysis over function's allocas. At -O0 every local variable lives in 
+	// its own alloca and is accessed through plain loads / stores, so we can treat those as 
+	// uses / definitions. Allocas used in any other way (GEPs, calls, taking the address) 
+	// are considered escaped and live everywhere.
+	struct LivenessInfo {
+		Function *F = nullptr;
+		DenseMap<Value *, unsigned> index;
+		BitVector escaped;
+		DenseMap<const BasicBlock *, BitVector> livein;
+
+		void reset(Function *);
+	};
+
+	// variables used by each region of the function's region tree. Every block contributes
+	// the candidate variables its instructions are using, every region is the union of its 
+	// own blocks and its children. Computed bottom-up in a single sweep over the tree.
+	struct RegionSummaries {
+		Function *F = nullptr;
+		DenseMap<Value *, unsigned> index;
+		std::vector<Value *> variables;
+		std::vector<BitVector> blockuses; // indexed by block number.
+		DenseMap<const Region *, BitVector> uses;
+
+		void reset(Function *NewF) { F = NewF; index.clear(); variables.clear(); blockuses.clear(); uses.clear(); }
+	};
+
+	// dense numbering of function's basic blocks. Reachability and region membership are kept as 
+	// bit vectors indexed by block number and are shared by all regions of the function.
+	struct BlockInfo {
+		Function *F = nullptr;
+		DenseMap<const BasicBlock *, unsigned> number;
+		std::vector<BasicBlock *> blocks;
+		std::vector<unsigned> scc;        // block number -> strongly connected component.
+		std::vector<BitVector> reachable; // blocks reachable from each strongly connected component.
+		DenseMap<const Region *, BitVector> members;
+
+		void reset(Function *);
+		const BitVector& getMembers(Region *);
+		const BitVector& getReachable(const BasicBlock *BB) const { return reachable[scc[number.find(BB)->second]]; }
+		bool test(const BitVector& bits, const BasicBlock *BB) const {
+			auto it = number.find(BB);
+			return it != number.end() && bits.test(it->second);
+		}
+	};
+
+	// everything region analysis needs to know about a function that does not depend on the 
+	// region itself. Computed when the first region of the function is visited and thrown away 
+	// once we move on to another function.
+	struct FunctionContext {
+		Function *F = nullptr;
+		AreaLoc bounds;
+		DenseMap<const BasicBlock *, AreaLoc> blocklocs;
+		ConstantIndex constants; // magic number -> allocas / globals initialized to it.
+		BlockInfo blocks;
+		SliceCache slices;
+		CandidateCache candidates;
+		LivenessInfo liveness;
+		RegionSummaries summaries;
+		bool analysed = false;   // everything above is only computed once some region misses the cache.
+		std::string fingerprint; // hash of function's IR and debug info, empty if cache is disabled.
+
+		void reset(const DebugInfoIndex&, Function *);
+		void analyse(const DebugInfoIndex&);
+		const AreaLoc& getBBLoc(const BasicBlock *BB) const { return blocklocs.find(BB)->second; }
 	};
 
 	// XML writer helper.
-	static std::string XMLOpeningTag(const char *, int);
-	static std::string XMLClosingTag(const char *, int);
-	template<typename T> static std::string XMLElement(const char *, T, int);
+	static raw_ostream& XMLOpeningTag(raw_ostream&, const char *, int);
+	static raw_ostream& XMLClosingTag(raw_ostream&, const char *, int);
+	template<typename T> static raw_ostream& XMLElement(raw_ostream&, const char *, const T&, int);
+	static void writeJSONString(raw_ostream&, StringRef);
+	static RecordWriter& getRecordWriter();
+	static bool readBinaryRecord(StringRef, RegionRecord&);
+	static raw_ostream * getAggregateStream();
 
 	// various I/O / region validation funcs.
-	static void readRegionFile(StringMap<StringSet<>>&, const std::string&);
-	static bool inRegionList(StringMap<StringSet<>>&, Function *, Region *);
-	static std::string generateFilename(Function *, Region *);
-	static void writeVariableInfo(VariableInfo&, bool, std::ofstream&);
-	static void writeLocInfo(AreaLoc&, const char *, std::ofstream&);
+	static bool parseSelector(StringRef, RegionSelector&);
+	static void selectRegions(const RegionListIndex&, Function&, RegionInfo&, std::vector<Region *>&);
+	static Region * findRegion(RegionInfo&, BasicBlock *, BasicBlock *);
+	static std::string generateFilename(Function *, BasicBlock *, BasicBlock *);
+	static ShardSpec parseShard();
+	static bool inShard(const ShardSpec&, Function *, BasicBlock *, BasicBlock *);
+	static void writeVariableInfo(const VariableInfo&, raw_ostream&);
+	static void writeLocInfo(const AreaLoc&, const char *, raw_ostream&);
+	static void writeRegionRecord(const RegionRecord&, StringRef);
 
 	// various functions dealing with finding line numbers for various things.
 	static inline AreaLoc getBBLoc(const BasicBlock *);
-	static AreaLoc getRegionLoc(const Region *);
-	static AreaLoc getFunctionLoc(const Function *);
-	static DenseSet<int> regionGetExitingLocs(Region *);
+	static AreaLoc getRegionLoc(const FunctionContext&, const BitVector&);
+	static AreaLoc getFunctionLoc(const FunctionContext&);
+	static DenseSet<int> regionGetExitingLocs(const FunctionContext&, const BitVector&);
 
-	static Metadata * getMetadata(Value *);
+	static Metadata * getMetadata(const DebugInfoIndex&, Value *);
 	static bool declaredInArea(Metadata *, const AreaLoc&);
-	static bool isArgument(Value *);
-	static DenseSet<BasicBlock *> collectSuccessorBasicBlocks(Region *);
-	static DenseSet<Value *> DFSInstruction(Value *);
-	static DenseSet<ValuePair> findBasicConstants(Function *, const AreaLoc&);
-	static void findInputs(Instruction *, const AreaLoc&, const AreaLoc&, const DenseSet<ValuePair>&,
-						   DenseSet<Value *>&, DenseSet<Value *>&);
-	static void findOutputs(Instruction *, const AreaLoc&, const AreaLoc&, const DenseSet<ValuePair>&,
-						    DenseSet<Value *>&, DenseSet<Value *>&);
-	static VariableInfo getTypeString(DIType *, StringRef);
-	static VariableInfo getVariableInfo(Value *);
-	static std::string getFunctionReturnType(const Function *);
+	static bool isArgument(const DebugInfoIndex&, Value *);
+	static BitVector collectSuccessorBasicBlocks(const BlockInfo&, const RegionDesc&);
+	template<typename Fn> static void forEachSliceOperand(Value *, Fn);
+	static DenseSet<Value *> DFSInstruction(const DebugInfoIndex&, Value *);
+	static ConstantIndex findBasicConstants(const DebugInfoIndex&, Function *);
+	static void findInputs(const DebugInfoIndex&, Instruction *, const AreaLoc&, 
+						   const ConstantIndex&, SliceCache&, DenseSet<Value *>&, DenseSet<Value *>&);
+	static void findOutputs(const DebugInfoIndex&, Instruction *, const AreaLoc&, 
+							const ConstantIndex&, SliceCache&, DenseSet<Value *>&, DenseSet<Value *>&);
+	static void classifyCandidate(const DebugInfoIndex&, Value *, bool, bool, const AreaLoc&, 
+								  DenseSet<Value *>&, DenseSet<Value *>&);
+	static std::pair<bool, bool> findUsingAreas(const DebugInfoIndex&, Value *, const BlockInfo&, const BitVector&, const BitVector&);
+	static void findInputsOutputsByUses(const DebugInfoIndex&, const CandidateCache&, const AreaLoc&, const AreaLoc&, 
+										const ConstantIndex&,
+										const BlockInfo&, const BitVector&, const BitVector&, 
+										DenseSet<Value *>&, DenseSet<Value *>&);
+	static void summarizeRegions(const DebugInfoIndex&, FunctionContext&, Region *);
+	static void findInputsOutputsBySummary(const DebugInfoIndex&, const FunctionContext&, const AreaLoc&, 
+										   const RegionDesc&, const BitVector&, DenseSet<Value *>&, DenseSet<Value *>&);
+	static void classifyByLiveness(const DebugInfoIndex&, const LivenessInfo&, const BlockInfo&, const RegionDesc&, 
+								   const DenseSet<Value *>&, const DenseSet<Value *>&, 
+								   DenseSet<Value *>&, DenseSet<Value *>&);
+	static void findLiveExits(const FunctionContext&, const RegionDesc&, const DenseSet<Value *>&, 
+							  DenseMap<Value *, std::vector<int>>&);
+	static bool containsPointer(Type *);
+	static void findInputTargets(const DataLayout&, Value *, InputTargets&);
+	static bool mayAlias(const Value *, const Value *);
+	static void findPointerFacts(const DebugInfoIndex&, const BlockInfo&, const RegionDesc&, 
+								 const std::vector<SmallVector<Value *, 1>>&, std::vector<VariableInfo>&);
+	static void findMemoryEffects(const DebugInfoIndex&, const BlockInfo&, const RegionDesc&, const AreaLoc&, 
+								  const DenseSet<Value *>&, const DenseSet<Value *>&, const DenseSet<Value *>&, RegionRecord&);
+	static std::unique_ptr<TypeDeclarator> buildDeclarator(const DebugInfoIndex&, DIType *);
+	static const TypeDeclarator& getDeclarator(const DebugInfoIndex&, DIType *);
+	static VariableInfo getTypeString(const DebugInfoIndex&, DIType *, StringRef);
+	static void getVariableLayout(const DebugInfoIndex&, Value *, DIType *, VariableInfo&);
+	static VariableInfo getVariableInfo(const DebugInfoIndex&, Value *);
+	static std::string getFunctionReturnType(const DebugInfoIndex&, const Function *);
+	static void describeVariable(const DebugInfoIndex&, Metadata *, raw_ostream&);
+	static void fingerprintOperand(const DebugInfoIndex&, const DenseMap<const Value *, unsigned>&, Value *, raw_ostream&);
+	static std::string getMD5(StringRef);
+	static void fingerprintAttributes(const AttributeSet&, unsigned, raw_ostream&);
+	static std::string fingerprintFunction(const DebugInfoIndex&, Function *);
+	static std::string getCacheKey(const FunctionContext&, BasicBlock *, BasicBlock *);
+	static std::shared_ptr<RegionRecord> loadCachedRecord(const std::string&);
+	static void storeCachedRecord(const std::string&, const RegionRecord&);
+	static void prepareFunction(DebugInfoIndex&, FunctionContext&, Function *);
+	static RegionDesc describeRegion(const DebugInfoIndex&, FunctionContext&, Region *);
+	static RegionRecord analyseRegion(const DebugInfoIndex&, FunctionContext&, const RegionDesc&);
 
 
 	// various XML helper functions as we are saving all the extracted info
 	// in XML-like format. Better than self-improvised markup.  
-	static std::string XMLOpeningTag(const char *key, int numtabs) {
-		std::stringstream stream;
-		for (int i = 0; i < numtabs; i++) { stream << '\t'; }
-		stream << "<" << key << ">" << std::endl;
-		return stream.str();
+	static raw_ostream& XMLOpeningTag(raw_ostream& out, const char *key, int numtabs) {
+		for (int i = 0; i < numtabs; i++) { out << '\t'; }
+		return out << "<" << key << ">\n";
 	}
 
-	static std::string XMLClosingTag(const char *key, int numtabs) {
-		std::stringstream stream;
-		for (int i = 0; i < numtabs; i++) { stream << '\t'; }
-		stream << "</" << key << ">" << std::endl;
-		return stream.str();
+	static raw_ostream& XMLClosingTag(raw_ostream& out, const char *key, int numtabs) {
+		for (int i = 0; i < numtabs; i++) { out << '\t'; }
+		return out << "</" << key << ">\n";
 	}
 
-	template<typename T> static std::string XMLElement(const char *key, T value, int numtabs) {
-		std::stringstream stream;
-		for (int i = 0; i < numtabs; i++) { stream << '\t'; }
-		stream << "<" << key << ">" << value << "</" << key << ">" << std::endl;
-		return stream.str();
+	template<typename T> static raw_ostream& XMLElement(raw_ostream& out, const char *key, const T& value, int numtabs) {
+		for (int i = 0; i < numtabs; i++) { out << '\t'; }
+		return out << "<" << key << ">" << value << "</" << key << ">\n";
 	}
 
-	// returns true if current function and and the region can be found in the region list.
-	static bool inRegionList(StringMap<StringSet<>>& SM, Function *F, Region *R) {
-		// remove spaces from region name 
-		std::string regionname = R->getNameStr();
-		std::string::iterator n = std::remove_if(regionname.begin(), regionname.end(), 
-			  [](char c) { return std::isspace(static_cast<unsigned char >(c)); });
-		regionname.erase(n, regionname.end());
+	// bools used to go through std::stringstream, keep writing them as numbers.
+	template<> raw_ostream& XMLElement<bool>(raw_ostream& out, const char *key, const bool& value, int numtabs) {
+		return XMLElement(out, key, (unsigned)value, numtabs);
+	}
 
-		const auto& it = SM.find(regionname);
-		if (it == SM.end()) { return false; }
-		const StringSet<>& funclist = it->getValue(); 
-		if (funclist.find(F->getName()) == funclist.end()) { return false; }
+	static void writeJSONString(raw_ostream& out, StringRef str) {
+		out << '"';
+		for (char c: str) {
+			if (c == '"' || c == '\\') { out << '\\' << c; }
+			else if (c == '\n') { out << "\\n"; }
+			else if (c == '\t') { out << "\\t"; }
+			else if ((unsigned char)c < 0x20) { out << "\\u" << format_hex_no_prefix((unsigned char)c, 4); }
+			else { out << c; }
+		}
+		out << '"';
+	}
 
-		return true;
+	static RecordWriter& getRecordWriter() {
+		static XMLRecordWriter xml;
+		static JSONRecordWriter json;
+		static BinaryRecordWriter binary;
+		if (Format == JSONFormat)   { return json; }
+		if (Format == BinaryFormat) { return binary; }
+		return xml;
+	}
+
+	// reads a record written by BinaryRecordWriter. Returns false if data is malformed.
+	static bool readBinaryRecord(StringRef data, RegionRecord& record) {
+		const uint8_t *pos = data.bytes_begin();
+		const uint8_t *end = data.bytes_end();
+		bool ok = true;
+		auto next = [&]() -> uint64_t {
+			uint64_t value = 0;
+			for (unsigned shift = 0; ok; shift += 7) {
+				if (pos == end || shift > 63) { ok = false; break; }
+				uint8_t byte = *pos++;
+				value |= uint64_t(byte & 0x7f) << shift;
+				if (byte < 0x80) { break; }
+			}
+			return value;
+		};
+
+		if (!data.startswith("FXR4")) { return false; }
+		pos += 4;
+
+		std::vector<StringRef> strings(next());
+		for (StringRef& str: strings) {
+			uint64_t size = next();
+			if (!ok || size > uint64_t(end - pos)) { return false; }
+			str = StringRef(reinterpret_cast<const char *>(pos), size);
+			pos += size;
+		}
+		auto string = [&]() -> std::string {
+			uint64_t i = next();
+			if (i >= strings.size()) { ok = false; return ""; }
+			return strings[i].str();
+		};
+
+		record.funcname = string();
+		record.returntype = string();
+		record.region.first = next();
+		record.region.second = next();
+		record.function.first = next();
+		record.function.second = next();
+		uint64_t flags = next();
+		record.toplevel = flags & 1;
+		record.liveness = flags & 2;
+		record.readnone = flags & 4;
+		record.readonly = flags & 8;
+		record.argmemonly = flags & 16;
+		record.exits.resize(next());
+		for (int& i: record.exits) { i = next(); }
+
+		record.variables.resize(next());
+		for (VariableInfo& info: record.variables) {
+			info.name = string();
+			info.type = string();
+			flags = next();
+			info.typehasname = flags & BinaryRecordWriter::TypeHasName;
+			info.isfunptr    = flags & BinaryRecordWriter::IsFunPtr;
+			info.isconstq    = flags & BinaryRecordWriter::IsConstQ;
+			info.isstatic    = flags & BinaryRecordWriter::IsStatic;
+			info.isarrayt    = flags & BinaryRecordWriter::IsArrayT;
+			info.ismodified  = flags & BinaryRecordWriter::IsModified;
+			info.islocal     = flags & BinaryRecordWriter::IsLocal;
+			info.isoutput    = flags & BinaryRecordWriter::IsOutput;
+			info.isrestrict  = flags & BinaryRecordWriter::IsRestrict;
+			info.isnonnull   = flags & BinaryRecordWriter::IsNonNull;
+			info.size = next();
+			info.align = next();
+			info.pointeralign = next();
+			info.liveexits.resize(next());
+			for (int& i: info.liveexits) { i = next(); }
+			if (!ok) { break; }
+		}
+		return ok;
+	}
+
+	// returns the stream all records are appended to, nullptr if it could not be opened.
+	static raw_ostream * getAggregateStream() {
+		static std::unique_ptr<raw_fd_ostream> file;
+		static bool failed = false;
+		if (OutDirectory == "-") { return &outs(); }
+		if (file || failed) { return file.get(); }
+
+		std::error_code EC;
+		file.reset(new raw_fd_ostream(OutDirectory, EC, sys::fs::F_Append));
+		if (EC) {
+			errs() << "Could not open output file: " << EC.message() << "\n";
+			file.reset();
+			failed = true;
+		}
+		return file.get();
+	}
+
+	//write collected info using xml-like format
+	void XMLRecordWriter::write(const RegionRecord& record, raw_ostream& out) {
+		XMLOpeningTag(out, "extractinfo", 0);
+		writeLocInfo(record.region, "region", out);
+		writeLocInfo(record.function, "function", out);
+
+		// dump variable info...
+		for (const VariableInfo& info : record.variables) { writeVariableInfo(info, out); }
+
+		// dump region exit locs
+		for (int i : record.exits)   { XMLElement(out, "regionexit", i, 1); }
+		XMLElement(out, "funcreturntype", record.returntype, 1);
+		XMLElement(out, "funcname", record.funcname, 1);
+		XMLElement(out, "toplevel", record.toplevel, 1);
+		if (record.liveness) { XMLElement(out, "liveness", true, 1); }
+		if (record.readnone)   { XMLElement(out, "readnone", true, 1);   }
+		if (record.readonly)   { XMLElement(out, "readonly", true, 1);   }
+		if (record.argmemonly) { XMLElement(out, "argmemonly", true, 1); }
+		XMLClosingTag(out, "extractinfo", 0);
+	}
+
+	// same fields as XML, flags are only present if set.
+	void JSONRecordWriter::write(const RegionRecord& record, raw_ostream& out) {
+		out << "{\"region\":{\"start\":" << record.region.first << ",\"end\":" << record.region.second << "}";
+		out << ",\"function\":{\"start\":" << record.function.first << ",\"end\":" << record.function.second << "}";
+		out << ",\"variables\":[";
+		for (unsigned i = 0; i < record.variables.size(); i++) {
+			const VariableInfo& info = record.variables[i];
+			out << (i ? ",{" : "{") << "\"name\":";
+			writeJSONString(out, info.name);
+			out << ",\"type\":";
+			writeJSONString(out, info.type);
+			if (info.isoutput)    { out << ",\"isoutput\":true";    }
+			if (info.typehasname) { out << ",\"typehasname\":true"; }
+			if (info.isfunptr)    { out << ",\"isfunptr\":true";    }
+			if (info.isconstq)    { out << ",\"isconstq\":true";    }
+			if (info.isstatic)    { out << ",\"isstatic\":true";    }
+			if (info.isarrayt)    { out << ",\"isarrayt\":true";    }
+			if (info.ismodified)  { out << ",\"ismodified\":true";  }
+			if (info.islocal)     { out << ",\"islocal\":true";     }
+			if (info.isrestrict)  { out << ",\"isrestrict\":true";  }
+			if (info.isnonnull)   { out << ",\"isnonnull\":true";   }
+			if (info.size)  { out << ",\"size\":" << info.size;   }
+			if (info.align) { out << ",\"align\":" << info.align; }
+			if (info.pointeralign) { out << ",\"pointeralign\":" << info.pointeralign; }
+			if (!info.liveexits.empty()) {
+				out << ",\"liveexits\":[";
+				for (unsigned j = 0; j < info.liveexits.size(); j++) { out << (j ? "," : "") << info.liveexits[j]; }
+				out << "]";
+			}
+			out << "}";
+		}
+		out << "],\"regionexit\":[";
+		for (unsigned i = 0; i < record.exits.size(); i++) { out << (i ? "," : "") << record.exits[i]; }
+		out << "],\"funcreturntype\":";
+		writeJSONString(out, record.returntype);
+		out << ",\"funcname\":";
+		writeJSONString(out, record.funcname);
+		out << ",\"toplevel\":" << (record.toplevel ? "true" : "false");
+		if (record.liveness) { out << ",\"liveness\":true"; }
+		if (record.readnone)   { out << ",\"readnone\":true";   }
+		if (record.readonly)   { out << ",\"readonly\":true";   }
+		if (record.argmemonly) { out << ",\"argmemonly\":true"; }
+		out << "}\n";
+	}
+
+	unsigned BinaryRecordWriter::intern(StringRef str) {
+		auto it = index.insert(std::make_pair(str, strings.size()));
+		if (it.second) { strings.push_back(str); }
+		return it.first->second;
+	}
+
+	void BinaryRecordWriter::write(const RegionRecord& record, raw_ostream& out) {
+		// strings are referenced by the record, so they outlive the table.
+		index.clear();
+		strings.clear();
+		unsigned funcname = intern(record.funcname);
+		unsigned returntype = intern(record.returntype);
+		for (const VariableInfo& info : record.variables) { intern(info.name); intern(info.type); }
+
+		out << "FXR4";
+		encodeULEB128(strings.size(), out);
+		for (StringRef str: strings) { encodeULEB128(str.size(), out); out << str; }
+
+		encodeULEB128(funcname, out);
+		encodeULEB128(returntype, out);
+		encodeULEB128(record.region.first, out);
+		encodeULEB128(record.region.second, out);
+		encodeULEB128(record.function.first, out);
+		encodeULEB128(record.function.second, out);
+		encodeULEB128(record.toplevel | (record.liveness << 1) | (record.readnone << 2) | 
+					  (record.readonly << 3) | (record.argmemonly << 4), out);
+		encodeULEB128(record.exits.size(), out);
+		for (int i : record.exits) { encodeULEB128(i, out); }
+
+		encodeULEB128(record.variables.size(), out);
+		for (const VariableInfo& info : record.variables) {
+			unsigned flags = (info.typehasname ? TypeHasName : 0) | (info.isfunptr ? IsFunPtr : 0) |
+							 (info.isconstq ? IsConstQ : 0) | (info.isstatic ? IsStatic : 0) |
+							 (info.isarrayt ? IsArrayT : 0) | (info.ismodified ? IsModified : 0) |
+							 (info.islocal ? IsLocal : 0) | (info.isoutput ? IsOutput : 0) |
+							 (info.isrestrict ? IsRestrict : 0) | (info.isnonnull ? IsNonNull : 0);
+			encodeULEB128(index.find(info.name)->second, out);
+			encodeULEB128(index.find(info.type)->second, out);
+			encodeULEB128(flags, out);
+			encodeULEB128(info.size, out);
+			encodeULEB128(info.align, out);
+			encodeULEB128(info.pointeralign, out);
+			encodeULEB128(info.liveexits.size(), out);
+			for (int i : info.liveexits) { encodeULEB128(i, out); }
+		}
 	}
 
 	// generates the filename for the xml file output of the pass will be written to.
 	// follows the following format: functionname_startregion_endregion
-	static std::string generateFilename(Function *F, Region *R) {
+	static std::string generateFilename(Function *F, BasicBlock *entry, BasicBlock *exit) {
 		std::string funcname =  F->getName().str();
 
 #define NUMNAMES 2
-		std::string sname = R->getEntry()->getName().str();;
+		std::string sname = entry->getName().str();;
 		std::string ename = "fnend";
-		if (R->getExit()) { ename= R->getExit()->getName().str(); }
+		if (exit) { ename= exit->getName().str(); }
 
 		std::string blocknames[NUMNAMES] = { sname, ename };
 
@@ -144,6 +702,7 @@ namespace {
 		unsigned max = std::numeric_limits<unsigned>::min();
 
 		for (const Instruction& I: BB->getInstList()) {
+			if (isa<DbgValueInst>(&I)) { continue; } // located at the declaration of the variable.
 			const DebugLoc& x = I.getDebugLoc(); 
 			if (x) {
 				min = std::min(min, x.getLine());
@@ -157,12 +716,12 @@ namespace {
 	// finds first / last line numbers of the region. 
 	// inaccurate when region contains an entry basic block due to function
 	// arguments being pushed onto the stack.
-	static inline AreaLoc getRegionLoc(const Region *R) {
+	static inline AreaLoc getRegionLoc(const FunctionContext& ctx, const BitVector& members) {
 		unsigned min = std::numeric_limits<unsigned>::max();
 		unsigned max = std::numeric_limits<unsigned>::min();
 
-		for (BasicBlock *BB: R->blocks()) {
-			AreaLoc a = getBBLoc(BB);
+		for (int i = members.find_first(); i != -1; i = members.find_next(i)) {
+			const AreaLoc& a = ctx.getBBLoc(ctx.blocks.blocks[i]);
 			min = std::min(min, a.first);
 			max = std::max(max, a.second);
 		}
@@ -171,13 +730,13 @@ namespace {
 	}
 
 	// finds first / last line numbers of the function. 
-	static inline AreaLoc getFunctionLoc(const Function *F) {
-		Metadata *M = F->getMetadata(0);
+	static inline AreaLoc getFunctionLoc(const FunctionContext& ctx) {
+		Metadata *M = ctx.F->getMetadata(0);
 		unsigned min = cast<DISubprogram>(M)->getLine(); 
 		unsigned max = std::numeric_limits<unsigned>::min();
 
-		for (const BasicBlock& BB: F->getBasicBlockList()) {
-			AreaLoc a = getBBLoc(&BB);
+		for (const BasicBlock& BB: ctx.F->getBasicBlockList()) {
+			const AreaLoc& a = ctx.getBBLoc(&BB);
 			min = std::min(min, a.first);
 			max = std::max(max, a.second);
 		}
@@ -188,68 +747,235 @@ namespace {
 	// we need line numbers exiting basic blocks to determine what kind of 
 	// branching we have there. In case if those lines of code contain goto/return,
 	// we have to do some extra work...
-	static DenseSet<int> regionGetExitingLocs(Region *R) {
+	static DenseSet<int> regionGetExitingLocs(const FunctionContext& ctx, const BitVector& members) {
 		DenseSet<int> out;
-		for (BasicBlock *BB : R->blocks())
-		for (auto succIt = succ_begin(BB); succIt != succ_end(BB); ++succIt) {
-			if (!R->contains(*succIt)) {
-				// need to iterate over each instruction in each basic block 
+		for (int i = members.find_first(); i != -1; i = members.find_next(i)) {
+			BasicBlock *BB = ctx.blocks.blocks[i];
+			for (auto succIt = succ_begin(BB); succIt != succ_end(BB); ++succIt) {
+				// last line of the block has been found by looking at every instruction
 				// as terminator instruction does not always have debug metadata...
-				unsigned max = std::numeric_limits<unsigned>::min();
-				for (Instruction& I: BB->getInstList()) { 
-					const DebugLoc& x = I.getDebugLoc();
-					if (x) { max = std::max(max, x.getLine()); }
-				}
-				out.insert(max);
+				if (!ctx.blocks.test(members, *succIt)) { out.insert(ctx.getBBLoc(BB).second); }
 			}
 		}
 
 		return out;
 	}
 
+	void DebugInfoIndex::reset(Module *NewM) {
+		M = NewM;
+		locals.clear();
+		globals.clear();
+		statics.clear();
+		indexed.clear();
+		functions.clear();
+		types.types.clear();
+		for (Function& F: *M) { functions.insert(std::make_pair(&F, functions.size())); }
+
+		for (GlobalVariable& G: M->globals()) {
+			SmallVector<DIGlobalVariable *, 1> sm;
+			G.getDebugInfo(sm);	
+			if (sm.size() != 1) { continue; }
+			globals.insert(std::make_pair(&G, sm[0]));
+
+			// globals declared inside function body are scoped to its subprogram 
+			// (or one of its lexical blocks).
+			if (auto *scope = dyn_cast_or_null<DILocalScope>(sm[0]->getScope())) {
+				statics[scope->getSubprogram()].push_back(&G);
+			}
+		}
+	}
+
+	void DebugInfoIndex::indexFunction(Function *F) {
+		if (!indexed.insert(F).second) { return; }
+		for (BasicBlock& BB: F->getBasicBlockList())
+		for (Instruction& I: BB.getInstList()) {
+			if (auto *DDI = dyn_cast<DbgDeclareInst>(&I)) {
+				if (Value *address = DDI->getAddress()) { locals.insert(std::make_pair(address, DDI->getVariable())); }
+			}
+
+			// variables of inlined functions are not variables of the region. A value bound to 
+			// several variables stays with the first one.
+			if (auto *DVI = dyn_cast<DbgValueInst>(&I)) {
+				DILocalVariable *var = DVI->getVariable();
+				if (var->getScope()->getSubprogram() != F->getSubprogram()) { continue; }
+				locals.insert(std::make_pair(DVI, var));
+				Value *value = DVI->getValue();
+				if (value && !isa<Constant>(value)) { locals.insert(std::make_pair(value, var)); }
+			}
+		}
+	}
+
+	// drops locals of the function, must be called before its body is deleted.
+	void DebugInfoIndex::forgetFunction(Function *F) {
+		if (!indexed.erase(F)) { return; }
+		for (BasicBlock& BB: F->getBasicBlockList())
+		for (Instruction& I: BB.getInstList()) {
+			if (auto *DDI = dyn_cast<DbgDeclareInst>(&I)) {
+				if (Value *address = DDI->getAddress()) { locals.erase(address); }
+			}
+			if (auto *DVI = dyn_cast<DbgValueInst>(&I)) {
+				locals.erase(DVI);
+				if (Value *value = DVI->getValue()) { locals.erase(value); }
+			}
+		}
+	}
+
+	const std::vector<GlobalVariable *>& DebugInfoIndex::getStatics(const Function *F) const {
+		static const std::vector<GlobalVariable *> none;
+		auto it = statics.find(F->getSubprogram());
+		return (it == statics.end()) ? none : it->second;
+	}
+
+	// true if the global is a static declared inside the function's body, same test as in reset().
+	bool DebugInfoIndex::isStatic(const Function *F, const GlobalVariable *G) const {
+		DIGlobalVariable *DGV = globals.lookup(G);
+		auto *scope = DGV ? dyn_cast_or_null<DILocalScope>(DGV->getScope()) : nullptr;
+		return scope && scope->getSubprogram() == F->getSubprogram();
+	}
+
 	// wrapper method for conveniently getting values metadata.
 	// returns nullptr if metadata is not found. 
-	static Metadata * getMetadata(Value *V) {
-		if (auto *a = dyn_cast<AllocaInst>(V)) {
-			DbgDeclareInst *DDI = FindAllocaDbgDeclare(a);
-			if (DDI) { return DDI->getVariable(); }
-		}
+	static Metadata * getMetadata(const DebugInfoIndex& DI, Value *V) {
+		auto local = DI.locals.find(V);
+		if (local != DI.locals.end()) { return local->second; }
 
 		if (auto *a = dyn_cast<GlobalVariable>(V)) {
-			SmallVector<DIGlobalVariable *, 1> sm;
-			a->getDebugInfo(sm);	
-			if (sm.size() == 1) { return sm[0]; }
+			auto it = DI.globals.find(a);
+			if (it != DI.globals.end()) { return it->second; }
 		}
 
 		return nullptr;
 	}
 	
-	// reads list of <functionname, regionname> from the file into the map.
-	static void readRegionFile(StringMap<StringSet<>>& S, const std::string& filename) {
-		std::ifstream stream;
-		stream.open(filename);
+	// parses the region part of a selector: "entry => exit", "start-end" or "*".
+	static bool parseSelector(StringRef text, RegionSelector& out) {
+		text = text.trim();
+		if (text == "*") { out.kind = RegionSelector::EveryRegion; return true; }
+
+		size_t arrow = text.find("=>");
+		if (arrow != StringRef::npos) {
+			out.kind = RegionSelector::BlockNames;
+			out.entry = text.substr(0, arrow).trim().str();
+			out.exit  = text.substr(arrow + 2).trim().str();
+			if (out.exit == "<Function Return>") { out.exit = "<FunctionReturn>"; }
+			return !out.entry.empty() && !out.exit.empty();
+		}
+
+		std::pair<StringRef, StringRef> range = text.split('-');
+		out.kind = RegionSelector::LineRange;
+		if (range.first.trim().getAsInteger(10, out.lines.first) || range.second.trim().getAsInteger(10, out.lines.second)) { 
+			return false; 
+		}
+		return out.lines.first <= out.lines.second;
+	}
+
+	// reads the region list. Every line selects regions of some functions:
+	//   main: for.cond => for.end    regions by entry / exit block names.
+	//   main: 120-180                smallest region covering the lines.
+	//   main: *                      every region of the function.
+	//   ma?n*: ..., /ma.n/: ...      functions given by a glob or a regular expression (matching whole name).
+	//   file.c:120-180               functions of the source file, names with a '.' are file names.
+	//   *                            every region of every function.
+	// Empty lines and lines starting with '#' are skipped.
+	void RegionListIndex::read(const std::string& filename) {
+		ErrorOr<std::unique_ptr<MemoryBuffer>> buffer = MemoryBuffer::getFile(filename);
+		if (!buffer) {
+			errs() << "Could not read region list " << filename << ": " << buffer.getError().message() << "\n";
+			return;
+		}
+
+		for (line_iterator it(**buffer, true, '#'); !it.is_at_end(); ++it) {
+			StringRef line = it->trim();
+			if (line == "*") { everything = true; continue; }
+
+			// regular expressions may contain ':' themselves.
+			size_t colon = line.find(':', line.startswith("/") ? line.find('/', 1) : 0);
+			RegionSelector selector;
+			if (colon == StringRef::npos || !parseSelector(line.substr(colon + 1), selector)) {
+				errs() << filename << ":" << it.line_number() << ": invalid region selector, skipping...\n";
+				continue;
+			}
+
+			StringRef name = line.substr(0, colon).trim();
+			if (name.size() > 1 && name.startswith("/") && name.endswith("/")) {
+				std::unique_ptr<Regex> regex(new Regex(("^(" + name.drop_front().drop_back() + ")$").str()));
+				std::string error;
+				if (!regex->isValid(error)) {
+					errs() << filename << ":" << it.line_number() << ": " << error << ", skipping...\n";
+					continue;
+				}
+				regexes.push_back(std::make_pair(std::move(regex), selector));
+			} else if (name.find('.') != StringRef::npos) {
+				files[sys::path::filename(name)].push_back(std::make_pair(name.str(), selector));
+			} else if (name.find_first_of("*?[") != StringRef::npos) {
+				Expected<GlobPattern> glob = GlobPattern::create(name);
+				if (!glob) {
+					logAllUnhandledErrors(glob.takeError(), errs(), filename + ":" + Twine(it.line_number()) + ": ");
+					continue;
+				}
+				globs.push_back(std::make_pair(std::move(*glob), selector));
+			} else {
+				functions[name].push_back(selector);
+			}
+		}
+	}
+
+	// collects selectors matching the function, in the order of the region list kinds above.
+	void RegionListIndex::getSelectors(const Function& F, std::vector<const RegionSelector *>& out) const {
+		auto exact = functions.find(F.getName());
+		if (exact != functions.end()) {
+			for (const RegionSelector& selector: exact->getValue()) { out.push_back(&selector); }
+		}
 
-		std::string temp;
-		while (!stream.eof()) {
-			// remove whitespace from the string
-			std::getline(stream, temp);
-			std::string::iterator n = std::remove_if(temp.begin(), temp.end(), 
-				  [](char c) { return std::isspace(static_cast<unsigned char >(c)); });
-			temp.erase(n, temp.end());
+		for (auto& glob: globs) {
+			if (glob.first.match(F.getName())) { out.push_back(&glob.second); }
+		}
+
+		for (auto& regex: regexes) {
+			if (regex.first->match(F.getName())) { out.push_back(&regex.second); }
+		}
+
+		// line ranges ending before the function starts cannot be inside of it.
+		DISubprogram *SP = F.getSubprogram();
+		if (files.empty() || !SP) { return; }
+		auto candidates = files.find(sys::path::filename(SP->getFilename()));
+		if (candidates == files.end()) { return; }
+		for (auto& file: candidates->getValue()) {
+			StringRef path = SP->getFilename();
+			if (path != file.first && !path.endswith("/" + file.first)) { continue; }
+			if (file.second.kind == RegionSelector::LineRange && file.second.lines.second < SP->getLine()) { continue; }
+			out.push_back(&file.second);
+		}
+	}
 
-			size_t idx = temp.find(':');
-			if (idx == std::string::npos) { continue; }
-			std::string lhs = temp.substr(0, idx);
-			std::string rhs = temp.substr(idx + 1, temp.length());
+	bool RegionListIndex::isListed(const Function& F) const {
+		if (everything) { return true; }
+		std::vector<const RegionSelector *> selectors;
+		getSelectors(F, selectors);
+		return !selectors.empty();
+	}
 
-			std::pair<std::string, StringSet<>> kv(rhs, StringSet<>());
-			S.insert(kv);
+	void BlockLineIndex::reset(Function *F) {
+		blocks.clear();
+		maxend.clear();
+		for (BasicBlock& BB: F->getBasicBlockList()) {
+			AreaLoc loc = ::getBBLoc(&BB);
+			if (loc.first <= loc.second) { blocks.push_back(std::make_pair(loc, &BB)); }
+		}
 
-			StringSet<>& lst = S.find(rhs)->getValue();
-			lst.insert(lhs);
+		std::sort(blocks.begin(), blocks.end(), 
+			[](const std::pair<AreaLoc, BasicBlock *>& a, const std::pair<AreaLoc, BasicBlock *>& b) { return a.first < b.first; });
+		for (auto& block: blocks) {
+			maxend.push_back(std::max(block.first.second, maxend.empty() ? 0 : maxend.back()));
 		}
+	}
 
-		stream.close();
+	void BlockLineIndex::find(const AreaLoc& lines, SmallVectorImpl<BasicBlock *>& out) const {
+		auto last = std::upper_bound(blocks.begin(), blocks.end(), lines.second, 
+			[](unsigned line, const std::pair<AreaLoc, BasicBlock *>& block) { return line < block.first.first; });
+		for (size_t i = last - blocks.begin(); i > 0 && maxend[i - 1] >= lines.first; i--) {
+			if (blocks[i - 1].first.second >= lines.first) { out.push_back(blocks[i - 1].second); }
+		}
 	}
 
 	// one of the problems is detecting const ints/floats. while llvm ir
@@ -260,9 +986,12 @@ namespace {
 	// clang does the following:
 	// load 124 into constant %x; %2 = load %a; %3 = add 124 %2. 
 	// Solution: look at alloca instructions that only have one user and that 
-	// user is store instruction.
-	static DenseSet<ValuePair> findBasicConstants(Function *F, const AreaLoc& functionBounds) {
-		DenseSet<ValuePair> out;
+	// user is store instruction. In optimized code there is no alloca, but the
+	// constant still shows up in llvm.dbg.value of the variable.
+	static ConstantIndex findBasicConstants(const DebugInfoIndex& DI, Function *F) {
+		ConstantIndex out;
+		DenseMap<DILocalVariable *, Value *> bindings;    // variable -> its only constant, null if none.
+		std::vector<DbgValueInst *> values;
 
 		for (BasicBlock& BB: F->getBasicBlockList())
 		for (Instruction& I: BB.getInstList()) {
@@ -271,50 +1000,139 @@ namespace {
 				for (User *U: alloca->users()) {
 					if (auto *store = dyn_cast<StoreInst>(U)) {
 						Value *operand = store->getValueOperand();
-						ValuePair pair(operand, alloca);
-						if (isa<ConstantInt>(operand)) { out.insert(pair); }
-						if (isa<ConstantFP>(operand))  { out.insert(pair); }
+						if (isa<ConstantInt>(operand)) { out[operand].push_back(alloca); }
+						if (isa<ConstantFP>(operand))  { out[operand].push_back(alloca); }
 					}
 				}
 			}
+
+			// a variable is a constant only if all of its dbg.values bind the same constant,
+			// otherwise it is merely known at some points, e.g. the init of a loop counter.
+			if (auto *DVI = dyn_cast<DbgValueInst>(&I)) {
+				Value *operand = DVI->getValue();
+				Value *constant = operand && (isa<ConstantInt>(operand) || isa<ConstantFP>(operand)) ? operand : nullptr;
+				auto bound = bindings.insert(std::make_pair(DVI->getVariable(), constant));
+				if (bound.first->second != constant) { bound.first->second = nullptr; }
+				if (constant && DI.locals.count(DVI)) { values.push_back(DVI); }
+			}
+		}
+
+		for (DbgValueInst *DVI: values) {
+			if (bindings.lookup(DVI->getVariable())) { out[DVI->getValue()].push_back(DVI); }
 		}
 
 		// we also have to look for things like local static consts.
-		for (GlobalVariable& G: F->getParent()->globals()) {
-			Metadata *M = getMetadata(&G);
-			if (!M) { continue; }
-			if (G.isConstant() && declaredInArea(M, functionBounds)) {
-				Value *operand = G.getOperand(0);
-				ValuePair pair(operand, &G);
-				if (isa<ConstantInt>(operand)) { out.insert(pair); }
-				if (isa<ConstantFP>(operand))  { out.insert(pair); }
+		for (GlobalVariable *G: DI.getStatics(F)) {
+			if (G->isConstant()) {
+				Value *operand = G->getOperand(0);
+				if (isa<ConstantInt>(operand)) { out[operand].push_back(G); }
+				if (isa<ConstantFP>(operand))  { out[operand].push_back(G); }
 			}
 		}
 
 		return out;
 	}
 
-// finds all reachable basic blocks after exiting from the region.
-	static DenseSet<BasicBlock *> collectSuccessorBasicBlocks(Region *R) {
-		DenseSet<BasicBlock *> visited; 
-		std::deque<BasicBlock *> stack;
+	void FunctionContext::reset(const DebugInfoIndex& DI, Function *NewF) {
+		F = NewF;
+		analysed = false;
+		fingerprint.clear();
+		if (!CacheDirectory.empty()) { fingerprint = fingerprintFunction(DI, F); }
+		else { analyse(DI); }
+	}
+
+	void FunctionContext::analyse(const DebugInfoIndex& DI) {
+		analysed = true;
+		blocklocs.clear();
+		for (BasicBlock& BB: F->getBasicBlockList()) { blocklocs[&BB] = ::getBBLoc(&BB); }
+		bounds = getFunctionLoc(*this);
+		constants = findBasicConstants(DI, F);
+		blocks.reset(F);
+		slices.reset(DI, F);
+		if (Engine != ScanEngine) { candidates.reset(DI, constants, F); }
+		summaries.reset(F);
+		if (Liveness) { liveness.reset(F); }
+	}
 
-		stack.push_back(R->getEntry());
-		while (stack.size() != 0) { 
-			// pick the block and expand it. If it has been visited before, we do not expand it
-			BasicBlock *current = stack.front();
-			stack.pop_front();
-			if (visited.find(current) != visited.end()) { continue; }
-			visited.insert(current);
-			for (auto it = succ_begin(current); it != succ_end(current); ++it) { stack.push_back(*it); }
+	void BlockInfo::reset(Function *NewF) {
+		F = NewF;
+		number.clear();
+		blocks.clear();
+		reachable.clear();
+		members.clear();
+
+		for (BasicBlock& BB: F->getBasicBlockList()) {
+			number.insert(std::make_pair(&BB, blocks.size()));
+			blocks.push_back(&BB);
 		}
 
-		// remove basic blocks belonging to the region.
-		for (auto it = R->block_begin(); it != R->block_end(); ++it) { visited.erase(*it); }
-		return visited;
+		// strongly connected components come in reverse topological order, so everything 
+		// reachable from the component's successors is already known when we get to it.
+		unsigned numblocks = blocks.size();
+		scc.assign(numblocks, std::numeric_limits<unsigned>::max());
+		for (auto it = scc_begin(F); !it.isAtEnd(); ++it) {
+			BitVector bits(numblocks);
+			for (BasicBlock *BB: *it) { 
+				bits.set(number[BB]); 
+				scc[number[BB]] = reachable.size(); 
+			}
+
+			for (BasicBlock *BB: *it)
+			for (auto succIt = succ_begin(BB); succIt != succ_end(BB); ++succIt) {
+				unsigned succscc = scc[number[*succIt]];
+				if (succscc != reachable.size()) { bits |= reachable[succscc]; }
+			}
+
+			reachable.push_back(bits);
+		}
+
+		// blocks unreachable from function entry only reach themselves as far as we care.
+		for (unsigned i = 0; i < numblocks; i++) {
+			if (scc[i] != std::numeric_limits<unsigned>::max()) { continue; }
+			scc[i] = reachable.size();
+			reachable.push_back(BitVector(numblocks));
+			reachable.back().set(i);
+		}
+	}
+
+	const BitVector& BlockInfo::getMembers(Region *R) {
+		auto it = members.find(R);
+		if (it != members.end()) { return it->second; }
+
+		BitVector bits(blocks.size());
+		for (BasicBlock *BB: R->blocks()) { bits.set(number[BB]); }
+		return members[R] = bits;
 	}
 
-	static DenseSet<Value *> DFSInstruction(Value *I) {
+	// finds all reachable basic blocks after exiting from the region.
+	static BitVector collectSuccessorBasicBlocks(const BlockInfo& info, const RegionDesc& R) {
+		BitVector out = info.getReachable(R.entry);
+		out.reset(R.members);
+		return out;
+	}
+
+	// calls Fn on every operand DFSInstruction is expanding. Constant expressions are only 
+	// followed into globals they reference.
+	template<typename Fn> static void forEachSliceOperand(Value *V, Fn fn) {
+		if (ConstantExpr *constexp = dyn_cast<ConstantExpr>(V)) {
+			for (auto it = constexp->op_begin(); it != constexp->op_end(); ++it) {
+				if (auto globl = dyn_cast<GlobalVariable>(*it)) { fn(globl); }
+			}
+		}
+
+		if (Instruction *instr = dyn_cast<Instruction>(V)) {
+			for (auto it = instr->op_begin(); it != instr->op_end(); ++it) {
+				if (auto globl    = dyn_cast<GlobalVariable>(*it)) { fn(globl);    }
+				if (auto instr    = dyn_cast<Instruction>(*it))    { fn(instr);    }
+				if (auto constexp = dyn_cast<ConstantExpr>(*it))   { fn(constexp); }
+				if (auto arg      = dyn_cast<Argument>(*it))       { fn(arg);      }
+			}
+		}
+	}
+
+	// values bound to a variable by llvm.dbg.value stand for reads of the variable, so the 
+	// search stops there instead of going on into whatever the variable was computed from.
+	static DenseSet<Value *> DFSInstruction(const DebugInfoIndex& DI, Value *I) {
 		DenseSet<Value *> visited; 
 
 		std::deque<Value *> stack;
@@ -325,55 +1143,94 @@ namespace {
 			stack.pop_back();
 			if (visited.find(current) != visited.end()) { continue; }
 			visited.insert(current);
-
-			if (ConstantExpr *constexp = dyn_cast<ConstantExpr>(current)) {
-				//Instruction *BB = constexp->getAsInstruction();
-				for (auto it = constexp->op_begin(); it != constexp->op_end(); ++it) {
-					if (auto globl = dyn_cast<GlobalVariable>(*it)) { stack.push_back(globl); }
-				}
-			}
-
-			if (Instruction *instr = dyn_cast<Instruction>(current)) {
-				for (auto it = instr->op_begin(); it != instr->op_end(); ++it) {
-					if (auto globl    = dyn_cast<GlobalVariable>(*it)) { stack.push_back(globl);    }
-					if (auto instr    = dyn_cast<Instruction>(*it))    { stack.push_back(instr);    }
-					if (auto constexp = dyn_cast<ConstantExpr>(*it))   { stack.push_back(constexp); }
-				}
-			}
+			++NumSliceVisited;
+			if (current != I && DI.locals.count(current)) { continue; }
+			forEachSliceOperand(current, [&](Value *op) { stack.push_back(op); });
 		}
 
-		// we are only interested in alloca instructions, remove everything else...
+		// we are only interested in variables, remove everything else...
 		for (Value *val: visited) {
-			if (!isa<AllocaInst>(val) && !isa<GlobalVariable>(val)) { visited.erase(val); }
+			if (!isa<AllocaInst>(val) && !isa<GlobalVariable>(val) && !DI.locals.count(val)) { visited.erase(val); }
 		}
 
 		return visited;
 	}
 
+	// returns the set of allocas / globals reachable from V's operand chain. Operands are 
+	// visited in post-order so that every value on the way gets its own slice memoized and 
+	// later queries stop as soon as they hit a known value. Values sitting on a cycle (phi 
+	// nodes) cannot be summarized this way - for those we fall back to plain DFSInstruction.
+	const DenseSet<Value *>& SliceCache::get(Value *Root) {
+		++NumSliceQueries;
+		if (NoSliceCache) { scratch = DFSInstruction(*DI, Root); return scratch; }
+
+		auto found = slices.find(Root);
+		if (found != slices.end()) { ++NumSliceHits; return found->second; }
+
+		DenseSet<Value *> entered;    // values we have started expanding during this query.
+		DenseSet<Value *> incomplete; // values whose slice depends on a cycle.
+		std::vector<std::pair<Value *, bool>> stack;
+		stack.push_back(std::make_pair(Root, false));
+
+		while (stack.size() != 0) {
+			Value *current = stack.back().first;
+
+			if (!stack.back().second) {
+				if (slices.count(current) || entered.count(current)) { stack.pop_back(); continue; }
+				entered.insert(current);
+				stack.back().second = true;
+				++NumSliceVisited;
+				forEachSliceOperand(current, [&](Value *op) {
+					if (!slices.count(op) && !DI->locals.count(op)) { stack.push_back(std::make_pair(op, false)); }
+				});
+				continue;
+			}
+
+			// all operands have been expanded by now, unless they are part of a cycle.
+			stack.pop_back();
+			DenseSet<Value *> slice;
+			bool complete = true;
+			if (isa<AllocaInst>(current) || isa<GlobalVariable>(current) || DI->locals.count(current)) { slice.insert(current); }
+			forEachSliceOperand(current, [&](Value *op) {
+				if (DI->locals.count(op)) { slice.insert(op); return; } // see DFSInstruction.
+				auto it = slices.find(op);
+				if (it == slices.end()) { complete = false; return; }
+				slice.insert(it->second.begin(), it->second.end());
+			});
+
+			if (complete) { slices[current] = std::move(slice); }
+			else          { incomplete.insert(current); }
+		}
+
+		if (incomplete.count(Root)) { slices[Root] = DFSInstruction(*DI, Root); }
+		return slices[Root];
+	}
+
 	
-	static void findInputs(Instruction *I, 
-						   const AreaLoc& funcloc, 
+	static void findInputs(const DebugInfoIndex& DI,
+						   Instruction *I, 
 						   const AreaLoc& regionloc,
-						   const DenseSet<ValuePair>& constants,
+						   const ConstantIndex& constants,
+						   SliceCache& cache,
 						   DenseSet<Value *>& previous,
 						   DenseSet<Value *>& arglist) {
-		DenseSet<Value *> sources = DFSInstruction(I);	
+		const DenseSet<Value *>& sources = cache.get(I);	
 		for (Value *V: sources) {
 			// we don't have to look at values we have seen before... 
 			if (previous.find(V) != previous.end()) { continue; }
 			previous.insert(V);
 
-			Metadata *M = getMetadata(V);
+			Metadata *M = getMetadata(DI, V);
 			if (!M) { continue; }
 
-			if (auto *instr = dyn_cast<AllocaInst>(V)) {
-				if (isArgument(instr))             { arglist.insert(instr); }
-				if (!declaredInArea(M, regionloc)) { arglist.insert(instr); }
+			if (!isa<GlobalVariable>(V)) {
+				if (isArgument(DI, V))             { arglist.insert(V); }
+				if (!declaredInArea(M, regionloc)) { arglist.insert(V); }
 			}
 
 			// globals must de declared inside the function.
 			if (auto *globl = dyn_cast<GlobalVariable>(V)) {
-				if (declaredInArea(M, funcloc) && !declaredInArea(M, regionloc)) { 
+				if (DI.isStatic(I->getFunction(), globl) && !declaredInArea(M, regionloc)) { 
 					arglist.insert(globl); 
 				}
 			}
@@ -383,39 +1240,40 @@ namespace {
 		// basic consts list.
 		for (Value *V : I->operands()) {
 			if (!isa<ConstantInt>(V) && !isa<ConstantFP>(V)) { continue; }
-			for (const ValuePair& constant: constants) {
-				if (constant.first == V) {
-					Metadata *M = getMetadata(constant.second); // get alloca instruction info;
-					if (!M) { continue; }
-					if (!declaredInArea(M, regionloc)) { arglist.insert(constant.second); }
-				}
+			auto it = constants.find(V);
+			if (it == constants.end()) { continue; }
+			for (Value *storage: it->second) {
+				Metadata *M = getMetadata(DI, storage); // get alloca instruction info;
+				if (!M) { continue; }
+				if (!declaredInArea(M, regionloc)) { arglist.insert(storage); }
 			}
 		}
 	}
 
-	static void findOutputs(Instruction *I, 
-						    const AreaLoc& funcloc, 
+	static void findOutputs(const DebugInfoIndex& DI,
+							Instruction *I, 
 						    const AreaLoc& regionloc,
-						    const DenseSet<ValuePair>& constants,
+						    const ConstantIndex& constants,
+						    SliceCache& cache,
 						    DenseSet<Value *>& previous,
 						    DenseSet<Value *>& arglist) {
-		DenseSet<Value *> sources = DFSInstruction(I);	
+		const DenseSet<Value *>& sources = cache.get(I);	
 		for (Value *V: sources) {
 			// we don't have to look at values we have seen before... 
 			if (previous.find(V) != previous.end()) { continue; }
 			previous.insert(V);
 
-			Metadata *M = getMetadata(V);
+			Metadata *M = getMetadata(DI, V);
 			if (!M) { continue; }
-			if (auto *instr = dyn_cast<AllocaInst>(V)) {
-				if (declaredInArea(M, regionloc) && !isArgument(instr)) { 
-					arglist.insert(instr); 
+			if (!isa<GlobalVariable>(V)) {
+				if (declaredInArea(M, regionloc) && !isArgument(DI, V)) { 
+					arglist.insert(V); 
 				}
 			}
 
 			// globals (const qualified structures) must de declared inside the function.
 			if (auto *globl = dyn_cast<GlobalVariable>(V)) {
-				if (declaredInArea(M, funcloc) && declaredInArea(M, regionloc)) { 
+				if (DI.isStatic(I->getFunction(), globl) && declaredInArea(M, regionloc)) { 
 					arglist.insert(globl); 
 				}
 			}
@@ -423,202 +1281,1292 @@ namespace {
 
 		for (Value *V : I->operands()) {
 			if (!isa<ConstantInt>(V) && !isa<ConstantFP>(V)) { continue; }
-			for (const ValuePair& constant: constants) {
-				if (constant.first == V) {
-					Metadata *M = getMetadata(constant.second); // get alloca instruction info;
-					if (!M) { continue; }
-					if (declaredInArea(M, regionloc)) { arglist.insert(constant.second); }
-				}
+			auto it = constants.find(V);
+			if (it == constants.end()) { continue; }
+			for (Value *storage: it->second) {
+				Metadata *M = getMetadata(DI, storage); // get alloca instruction info;
+				if (!M) { continue; }
+				if (declaredInArea(M, regionloc)) { arglist.insert(storage); }
 			}
 		}
 	}
 
-	// compares M's line parameter to AreaLoc, returns true if number is between.
-	static bool declaredInArea(Metadata *M, const AreaLoc& A) {
-		unsigned linenum = std::numeric_limits<unsigned>::max();
-		if (auto *a = dyn_cast<DIGlobalVariable>(M)) { linenum = a->getLine(); }
-		if (auto *a  = dyn_cast<DILocalVariable>(M)) { linenum = a->getLine(); }
-		if (linenum == std::numeric_limits<unsigned>::max()) { return false; }
-		return (A.first <= linenum && linenum <= A.second);
-	}
-
-	// debug info also tells us if given alloca istruction is used for storing function
-	// arguments. Convenient as we don't need to manually look for matching AllocaInst. 
-	static bool isArgument(Value *V) {
-		DbgDeclareInst *DDI = FindAllocaDbgDeclare(V);
-		if (!DDI) { return false; }
-		DILocalVariable *DLV = DDI->getVariable();
-		return (DLV->getArg() != 0);
-	}
+	void CandidateCache::reset(const DebugInfoIndex& DI, const ConstantIndex& constants, Function *NewF) {
+		F = NewF;
+		variables.clear();
+		constantblocks.clear();
 
-	// extracts the type of the provided debuginfo type as a string. Follows the pointers 
-	// as necessary. std::pair is returned because function pointers have to be treated 
-	// slightly differently and in that case we do not have to append variable name.
-	static VariableInfo getTypeString(DIType *T, StringRef variablename) {
-		std::vector<unsigned> tags;
-		std::vector<DINodeArray> ranges; // for array size indexes
+		for (Argument& A: F->args()) {
+			if (getMetadata(DI, &A)) { variables.push_back(&A); }
+		}
 
-		Metadata *md = cast<Metadata>(T);
-		while (true) {
-			// do not need to look for anymore.
-			if (isa<DIBasicType>(md))      { break; }
-			if (isa<DISubroutineType>(md)) { break; }
+		for (BasicBlock& BB: F->getBasicBlockList())
+		for (Instruction& I: BB.getInstList()) {
+			if ((isa<AllocaInst>(&I) || DI.locals.count(&I)) && getMetadata(DI, &I)) { variables.push_back(&I); }
 
-			// we are interested in array type. 
-			if (auto a = dyn_cast<DICompositeType>(md)) {
-				auto t = a->getTag();
-				if (t == dwarf::DW_TAG_array_type)       { tags.push_back(t); ranges.push_back(a->getElements()); }
-				if (t == dwarf::DW_TAG_structure_type)   { tags.push_back(t); break; }
-				if (t == dwarf::DW_TAG_union_type)       { tags.push_back(t); break; }
-				if (t == dwarf::DW_TAG_enumeration_type) { tags.push_back(t); break; }
-				Metadata *next = a->getBaseType();
-				if (next == nullptr)  { break; } // no basetype property here, bailing
-				md = next; 
-				continue;
+			// constants are shared by the whole module, so their use lists are no good here.
+			for (Value *op: I.operand_values()) {
+				if (!constants.count(op)) { continue; }
+				std::vector<BasicBlock *>& blocks = constantblocks[op];
+				if (blocks.empty() || blocks.back() != &BB) { blocks.push_back(&BB); }
 			}
- 
-			if (auto a = dyn_cast<DIDerivedType>(md)) {
-				auto t = a->getTag();
-				if (t == dwarf::DW_TAG_pointer_type) { tags.push_back(t); }
-				if (t == dwarf::DW_TAG_const_type  ) { tags.push_back(t); }
-				if (t == dwarf::DW_TAG_typedef     ) { tags.push_back(t); break; }
-				Metadata *next = a->getBaseType();
-				if (next == nullptr)  { break; } // no basetype property here, bailing
-				md = next;
-			}
-
 		}
 
-		DIType *type = cast<DIType>(md);
-		//std::reverse(tags.begin(), tags.end());  
+		for (GlobalVariable *G: DI.getStatics(F)) { variables.push_back(G); }
+	}
 
-		VariableInfo ret = {"", "", false, false, false, false, false};
-		std::string typestr;
+	// decides whether candidate variable is an input and / or an output of the region, given 
+	// whether it is used inside the region and after it. Same rules as in findInputs / findOutputs.
+	static void classifyCandidate(const DebugInfoIndex& DI,
+								  Value *V, 
+								  bool usedinside,
+								  bool usedafter,
+								  const AreaLoc& regionloc,
+								  DenseSet<Value *>& inputs,
+								  DenseSet<Value *>& outputs) {
+		if (!usedinside && !usedafter) { return; }
+		Metadata *M = getMetadata(DI, V);
+		if (!M) { return; }
+
+		if (!isa<GlobalVariable>(V)) {
+			bool inregion = declaredInArea(M, regionloc);
+			if (usedinside && (isArgument(DI, V) || !inregion)) { inputs.insert(V);  }
+			if (usedafter && inregion && !isArgument(DI, V))    { outputs.insert(V); }
+		}
 
-		// function pointers have to be handled a tad differently.
-		// First argument in DISubroutineArray is return type;
-		// The rest are arguments' types. We also need a name of the value for this one - 
-		// terribly inconsistent but it works so far.
-		if (auto *a = dyn_cast<DISubroutineType>(md)) {
-			const auto& types = a->getTypeArray();
-			std::string lhs, rhs;
+		if (auto *globl = dyn_cast<GlobalVariable>(V)) {
+			bool inregion = declaredInArea(M, regionloc);
+			if (usedinside && !inregion) { inputs.insert(globl);  }
+			if (usedafter  &&  inregion) { outputs.insert(globl); }
+		}
+	}
 
-			// get function's return type
-			Metadata *rettypeinfo = types[0];
-			if (rettypeinfo == nullptr) { lhs += "void "; }  // void function
-			else { lhs += getTypeString(cast<DIType>(rettypeinfo), "").type; }
+	// follows V's users the same way DFSInstruction follows operands, only in the opposite 
+	// direction. Returns a pair of flags telling whether some user is located inside the region 
+	// and whether some user is located in one of region's successor blocks.
+	static std::pair<bool, bool> findUsingAreas(const DebugInfoIndex& DI,
+												Value *V, 
+												const BlockInfo& info,
+												const BitVector& regionblocks,
+												const BitVector& successors) {
+		std::pair<bool, bool> out(false, false);
+		DenseSet<Value *> visited;
+		std::vector<Value *> stack;
+		stack.push_back(V);
+
+		while (stack.size() != 0 && !(out.first && out.second)) {
+			Value *current = stack.back();
+			stack.pop_back();
+			if (visited.find(current) != visited.end()) { continue; }
+			visited.insert(current);
 
-			// get function's arguments' types
-			rhs += '(';
-			if (types.size() == 1) { rhs += "void)"; } // we have 0 input arguments...
-			for (unsigned i = 1; i < types.size(); i++) {
-				rhs += getTypeString(cast<DIType>(types[i]), "").type;	
-				if (i <  types.size() - 1) { rhs += ", ";}
-				if (i == types.size() - 1) { rhs += ")"; }
+			if (auto *instr = dyn_cast<Instruction>(current)) {
+				BasicBlock *BB = instr->getParent();
+				if (info.test(regionblocks, BB)) { out.first  = true; }
+				if (info.test(successors, BB))   { out.second = true; }
 			}
+			if (current != V && DI.locals.count(current)) { continue; }
 
-			// is function pointer constant or/and actually a pointer?
-			for (unsigned& t: tags) {
-				switch (t) {
-					case dwarf::DW_TAG_pointer_type: { typestr = " * " + typestr;     break; }
-					case dwarf::DW_TAG_const_type:   { typestr = " const " + typestr; break; }
-				}
+			// DFSInstruction only goes from constant expressions into globals, so the only 
+			// users of constant expression we have to follow are instructions.
+			for (User *U: current->users()) {
+				if (isa<Instruction>(U)) { stack.push_back(U); }
+				if (isa<ConstantExpr>(U) && isa<GlobalVariable>(current)) { stack.push_back(U); }
 			}
+		}
 
-			if (tags.size() != 0 && tags[0] == dwarf::DW_TAG_const_type) { ret.isconstq = true; }
-			ret.type = lhs + "( " + typestr + variablename.str() + " )" + rhs;
-			ret.isfunptr = true;
-			ret.typehasname = true;
-			return ret; 
+		return out;
+	}
+
+	// alternative to findInputs / findOutputs. Instead of going through every instruction of the
+	// region and its successors, we start from candidate variables and look where they are used.
+	static void findInputsOutputsByUses(const DebugInfoIndex& DI,
+										const CandidateCache& candidates,
+										const AreaLoc& funcloc,
+										const AreaLoc& regionloc,
+										const ConstantIndex& constants,
+										const BlockInfo& info,
+										const BitVector& regionblocks,
+										const BitVector& successors,
+										DenseSet<Value *>& inputs,
+										DenseSet<Value *>& outputs) {
+		for (Value *V: candidates.variables) {
+			std::pair<bool, bool> used = findUsingAreas(DI, V, info, regionblocks, successors);
+			classifyCandidate(DI, V, used.first, used.second, regionloc, inputs, outputs);
 		}
 
-		// depending on the type, we might need to add basetype name before or after 
-		bool baseTypeAdded   = false;	
-		std::string baseType = (type->getName().size() == 0) ? " void " : " " + type->getName().str() + " ";
+		// magic numbers are only looked up in instruction operands, no need to go any deeper.
+		for (auto& constant: constants)
+		for (Value *storage: constant.second) {
+			Metadata *M = getMetadata(DI, storage);
+			if (!M) { continue; }
+			bool inregion = declaredInArea(M, regionloc);
 
-		for (unsigned& t: tags) {
-			switch (t) {
-				case dwarf::DW_TAG_pointer_type:     { typestr = " * " + typestr; break; }
-				case dwarf::DW_TAG_structure_type:   { typestr = "struct" + baseType + typestr; baseTypeAdded = true; break; }
-				case dwarf::DW_TAG_union_type:       { typestr = "union"  + baseType + typestr; baseTypeAdded = true; break; }
-				case dwarf::DW_TAG_enumeration_type: { typestr = "enum "  + baseType + typestr; baseTypeAdded = true; break; }
-				case dwarf::DW_TAG_typedef:          { typestr = baseType + typestr; baseTypeAdded = true; break; }
-				case dwarf::DW_TAG_const_type:       { typestr = "const " + typestr; break; }
-				case dwarf::DW_TAG_array_type:       { 
-					ret.typehasname = true;
-					DINodeArray rangelist = ranges.back(); ranges.pop_back();
-					typestr = " ( " + typestr + " " + variablename.str() + " ) ";
-					for (auto elem = rangelist.begin(); elem != rangelist.end(); ++elem) {
-						if (auto a = cast<DISubrange>(*elem)) {
-							typestr += " [" + std::to_string(a->getCount()) + "] ";
-						}
-					}
-				}
+			auto blocks = candidates.constantblocks.find(constant.first);
+			if (blocks == candidates.constantblocks.end()) { continue; }
+			for (BasicBlock *BB: blocks->second) {
+				if (!inregion && info.test(regionblocks, BB)) { inputs.insert(storage);  }
+				if ( inregion && info.test(successors, BB))   { outputs.insert(storage); }
 			}
 		}
-
-		if (!baseTypeAdded) { typestr = baseType + typestr; }
-		// const qualified variables and arrays do not have to be restored.
-		if (tags.size() != 0 && tags[0] == dwarf::DW_TAG_const_type) { ret.isconstq = true; }
-		if (tags.size() != 0 && tags[0] == dwarf::DW_TAG_array_type) { ret.isarrayt = true; }
-		ret.type = typestr;
-		return ret; 
 	}
 
-	// self-explanatory. 
-	static std::string getFunctionReturnType(const Function *F) {
-		DISubprogram *SP = cast<DISubprogram>(F->getMetadata(0));
-		if (auto *ST = dyn_cast<DISubroutineType>(SP->getRawType())) {
-			Metadata *M = ST->getTypeArray()[0];
-			if (!M) { return std::string("void"); }
-			return getTypeString(cast<DIType>(M), "").type;
+	// builds summaries for the whole region tree R belongs to. Block summaries come from the
+	// same instruction slices the scan engine is using, so results are identical to it.
+	static void summarizeRegions(const DebugInfoIndex& DI, FunctionContext& ctx, Region *R) {
+		RegionSummaries& summaries = ctx.summaries;
+		const BlockInfo& blocks = ctx.blocks;
+		summaries.reset(ctx.F);
+		for (Value *V: ctx.candidates.variables) {
+			summaries.index.insert(std::make_pair(V, summaries.variables.size()));
+			summaries.variables.push_back(V);
+		}
+
+		unsigned numvars = summaries.variables.size();
+		for (BasicBlock *BB: blocks.blocks) {
+			BitVector bits(numvars);
+			for (Instruction& I: BB->getInstList()) {
+				for (Value *V: ctx.slices.get(&I)) {
+					auto it = summaries.index.find(V);
+					if (it != summaries.index.end()) { bits.set(it->second); }
+				}
+
+				for (Value *V : I.operands()) {
+					auto found = ctx.constants.find(V);
+					if (found == ctx.constants.end()) { continue; }
+					for (Value *storage: found->second) {
+						auto it = summaries.index.find(storage);
+						if (it != summaries.index.end()) { bits.set(it->second); }
+					}
+				}
+			}
+			summaries.blockuses.push_back(bits);
+		}
+
+		// every block contributes to the innermost region containing it...
+		RegionInfo *RI = R->getRegionInfo();
+		for (BasicBlock *BB: blocks.blocks) {
+			Region *owner = RI->getRegionFor(BB);
+			if (!owner) { continue; }
+			BitVector& bits = summaries.uses[owner];
+			bits.resize(numvars);
+			bits |= summaries.blockuses[blocks.number.find(BB)->second];
+		}
+
+		// ... and every region to its parent. Children have to be done before parents.
+		std::vector<Region *> order;
+		std::vector<Region *> stack;
+		stack.push_back(RI->getTopLevelRegion());
+		while (stack.size() != 0) {
+			Region *current = stack.back();
+			stack.pop_back();
+			order.push_back(current);
+			for (auto& child: *current) { stack.push_back(child.get()); }
+		}
+
+		for (auto it = order.rbegin(); it != order.rend(); ++it) {
+			BitVector& bits = summaries.uses[*it];
+			bits.resize(numvars);
+			if (Region *parent = (*it)->getParent()) { 
+				BitVector& parentbits = summaries.uses[parent];
+				parentbits.resize(numvars);
+				parentbits |= bits; 
+			}
+		}
+	}
+
+	// inputs / outputs straight from the summaries: variables used by the region itself and 
+	// variables used by any of the successor blocks.
+	static void findInputsOutputsBySummary(const DebugInfoIndex& DI,
+										   const FunctionContext& ctx,
+										   const AreaLoc& regionloc,
+										   const RegionDesc& R,
+										   const BitVector& successors,
+										   DenseSet<Value *>& inputs,
+										   DenseSet<Value *>& outputs) {
+		const RegionSummaries& summaries = ctx.summaries;
+		const BitVector& usedinside = R.uses;
+		BitVector usedafter(summaries.variables.size());
+		for (int i = successors.find_first(); i != -1; i = successors.find_next(i)) { 
+			usedafter |= summaries.blockuses[i]; 
+		}
+
+		for (unsigned i = 0; i < summaries.variables.size(); i++) {
+			classifyCandidate(DI, summaries.variables[i], usedinside.test(i), usedafter.test(i), 
+							  regionloc, inputs, outputs);
+		}
+	}
+
+	void LivenessInfo::reset(Function *NewF) {
+		F = NewF;
+		index.clear();
+		livein.clear();
+
+		for (BasicBlock& BB: F->getBasicBlockList())
+		for (Instruction& I: BB.getInstList()) {
+			if (isa<AllocaInst>(&I)) { index.insert(std::make_pair(&I, index.size())); }
+		}
+
+		unsigned numvars = index.size();
+		escaped = BitVector(numvars);
+		for (auto& kv: index)
+		for (User *U: kv.first->users()) {
+			if (auto *load = dyn_cast<LoadInst>(U)) { if (load->getPointerOperand() == kv.first) { continue; } }
+			if (auto *store = dyn_cast<StoreInst>(U)) {
+				if (store->getPointerOperand() == kv.first && store->getValueOperand() != kv.first) { continue; }
+			}
+			escaped.set(kv.second);
+		}
+
+		// per-block upward exposed uses and definitions.
+		DenseMap<const BasicBlock *, BitVector> uses, defs;
+		for (BasicBlock& BB: F->getBasicBlockList()) {
+			BitVector use(numvars), def(numvars);
+			for (Instruction& I: BB.getInstList()) {
+				if (auto *load = dyn_cast<LoadInst>(&I)) {
+					auto it = index.find(load->getPointerOperand());
+					if (it != index.end() && !def.test(it->second)) { use.set(it->second); }
+				}
+				if (auto *store = dyn_cast<StoreInst>(&I)) {
+					auto it = index.find(store->getPointerOperand());
+					if (it != index.end()) { def.set(it->second); }
+				}
+			}
+			def.reset(escaped); // we cannot tell if escaped variables are fully overwritten.
+			uses[&BB] = use;
+			defs[&BB] = def;
+			livein[&BB] = use;
+		}
+
+		// iterate until fixpoint. Going through blocks backwards converges faster.
+		bool changed = true;
+		while (changed) {
+			changed = false;
+			for (auto it = F->getBasicBlockList().rbegin(); it != F->getBasicBlockList().rend(); ++it) {
+				BasicBlock *BB = &*it;
+				BitVector live(numvars);
+				for (auto succIt = succ_begin(BB); succIt != succ_end(BB); ++succIt) { live |= livein[*succIt]; }
+				live.reset(defs[BB]);
+				live |= uses[BB];
+				if (live != livein[BB]) { livein[BB] = live; changed = true; }
+			}
+		}
+	}
+
+	// finds out which inputs / outputs have to be written back after the region (modified and 
+	// live at region exit) and which inputs do not have to be passed into the region at all 
+	// (not live at region entry). Dead outputs still have to be declared by the caller, they 
+	// just do not need their value. Only allocas are analysed, everything else is written back.
+	// Variables without alloca are written back if the region assigns them.
+	static void classifyByLiveness(const DebugInfoIndex& DI,
+								   const LivenessInfo& info,
+								   const BlockInfo& blockinfo,
+								   const RegionDesc& R,
+								   const DenseSet<Value *>& inputs,
+								   const DenseSet<Value *>& outputs,
+								   DenseSet<Value *>& modified,
+								   DenseSet<Value *>& locals) {
+		unsigned numvars = info.index.size();
+		BitVector liveout(numvars);
+		for (int i = R.members.find_first(); i != -1; i = R.members.find_next(i))
+		for (auto succIt = succ_begin(blockinfo.blocks[i]); succIt != succ_end(blockinfo.blocks[i]); ++succIt) {
+			if (!blockinfo.test(R.members, *succIt)) { liveout |= info.livein.find(*succIt)->second; }
+		}
+		liveout |= info.escaped;
+		const BitVector& liveentry = info.livein.find(R.entry)->second;
+
+		DenseSet<Metadata *> assigned;
+		for (int i = R.members.find_first(); i != -1; i = R.members.find_next(i))
+		for (Instruction& I: blockinfo.blocks[i]->getInstList()) {
+			if (isa<DbgValueInst>(&I)) { if (Metadata *M = getMetadata(DI, &I)) { assigned.insert(M); } }
+		}
+
+		for (Value *V: outputs) {
+			auto it = info.index.find(V);
+			if (it == info.index.end() || liveout.test(it->second)) { modified.insert(V); }
+		}
+
+		for (Value *V: inputs) {
+			auto it = info.index.find(V);
+			if (it == info.index.end()) { 
+				if (auto *globl = dyn_cast<GlobalVariable>(V)) { if (!globl->isConstant()) { modified.insert(V); } }
+				else if (assigned.count(getMetadata(DI, V))) { modified.insert(V); }
+				continue; 
+			}
+
+			unsigned idx = it->second;
+			bool written = false;
+			for (User *U: V->users()) {
+				auto *instr = dyn_cast<Instruction>(U);
+				if (!instr || !blockinfo.test(R.members, instr->getParent())) { continue; }
+				if (!isa<LoadInst>(instr)) { written = true; break; }
+			}
+
+			if (written && liveout.test(idx))                          { modified.insert(V); }
+			if (!liveentry.test(idx) && !info.escaped.test(idx))       { locals.insert(V);   }
+		}
+	}
+
+	// exit lines after which each modified variable is still needed, so that an exit only writes 
+	// back what its target reads. Exits sharing a line share the live set. Variables without alloca 
+	// and escaped ones are needed after every exit.
+	static void findLiveExits(const FunctionContext& ctx, const RegionDesc& R, const DenseSet<Value *>& modified,
+							  DenseMap<Value *, std::vector<int>>& liveexits) {
+		const LivenessInfo& info = ctx.liveness;
+		const BlockInfo& blockinfo = ctx.blocks;
+		DenseMap<int, BitVector> liveat;
+		for (int i = R.members.find_first(); i != -1; i = R.members.find_next(i))
+		for (auto succIt = succ_begin(blockinfo.blocks[i]); succIt != succ_end(blockinfo.blocks[i]); ++succIt) {
+			if (blockinfo.test(R.members, *succIt)) { continue; }
+			BitVector& live = liveat[ctx.getBBLoc(blockinfo.blocks[i]).second];
+			live.resize(info.index.size());
+			live |= info.livein.find(*succIt)->second;
+		}
+
+		for (Value *V: modified) {
+			auto it = info.index.find(V);
+			std::vector<int>& lines = liveexits[V];
+			for (auto& kv: liveat) {
+				if (it == info.index.end() || info.escaped.test(it->second) || kv.second.test(it->second)) { lines.push_back(kv.first); }
+			}
+			std::sort(lines.begin(), lines.end());
+		}
+	}
+
+	static bool containsPointer(Type *T) {
+		if (T->isPointerTy()) { return true; }
+		if (auto *a = dyn_cast<ArrayType>(T)) { return containsPointer(a->getElementType()); }
+		if (auto *a = dyn_cast<StructType>(T)) {
+			for (Type *E: a->elements()) { if (containsPointer(E)) { return true; } }
+		}
+		return false;
+	}
+
+	// adds what a single value of the input reaches. Pointer values are stores into pointer's 
+	// alloca at -O0, every use other than plain loads / stores leaves them unknown. 
+	static void findInputTargets(const DataLayout& DL, Value *V, InputTargets& targets) {
+		if (auto *a = dyn_cast<DbgValueInst>(V)) { V = a->getValue(); }
+		if (!V) { targets.complete = false; return; }
+
+		Type *storage = nullptr;
+		if (auto *a = dyn_cast<AllocaInst>(V))     { storage = a->getAllocatedType(); }
+		if (auto *a = dyn_cast<GlobalVariable>(V)) { storage = a->getValueType(); }
+		// pointers stored in what the input points to reach further objects we do not follow.
+		SmallVector<Value *, 4> pointers;
+		if (storage && storage->isArrayTy()) {
+			// arrays decay to the address of their storage.
+			targets.pointee = storage->getArrayElementType();
+			if (containsPointer(targets.pointee)) { targets.complete = false; }
+			pointers.push_back(V);
+		} else if (storage && storage->isPointerTy() && isa<AllocaInst>(V)) {
+			targets.pointee = storage->getPointerElementType();
+			if (containsPointer(targets.pointee)) { targets.complete = false; }
+			for (User *U: V->users()) {
+				if (isa<LoadInst>(U)) { continue; }
+				auto *store = dyn_cast<StoreInst>(U);
+				if (!store || store->getPointerOperand() != V) { targets.complete = false; return; }
+				pointers.push_back(store->getValueOperand());
+			}
+		} else if (storage) {
+			// pointer globals may be changed anywhere, aggregates may hold pointers we know nothing about.
+			if (containsPointer(storage)) { targets.complete = false; }
+			targets.storage = V;
+			targets.objects.insert(V);
+			return;
+		} else if (V->getType()->isPointerTy()) {
+			targets.pointee = V->getType()->getPointerElementType();
+			if (containsPointer(targets.pointee)) { targets.complete = false; }
+			pointers.push_back(V);
+		} else {
+			if (containsPointer(V->getType())) { targets.complete = false; }
+			return;
+		}
+
+		if (storage) { targets.storage = V; }
+		if (pointers.empty()) { targets.complete = false; }
+		targets.pointer = true;
+		for (Value *P: pointers) {
+			SmallVector<Value *, 4> objects;
+			GetUnderlyingObjects(P, objects, DL);
+			targets.objects.insert(objects.begin(), objects.end());
+			targets.nonnull = targets.nonnull && isKnownNonZero(P, DL);
+
+			// alignment of the alloca / global the value points into, reduced by constant offset.
+			APInt offset(DL.getPointerSizeInBits(), 0);
+			Value *base = P->stripAndAccumulateInBoundsConstantOffsets(DL, offset);
+			unsigned align = 0;
+			if (auto *a = dyn_cast<AllocaInst>(base)) { 
+				align = a->getAlignment() ? a->getAlignment() : DL.getABITypeAlignment(a->getAllocatedType()); 
+			}
+			if (auto *a = dyn_cast<GlobalVariable>(base)) {
+				if (a->getValueType()->isSized()) { align = a->getAlignment() ? a->getAlignment() : DL.getABITypeAlignment(a->getValueType()); }
+			}
+			align = align ? MinAlign(align, offset.getZExtValue()) : 0;
+			targets.align = targets.aligned ? std::min(targets.align, align) : align;
+			targets.aligned = true;
+		}
+	}
+
+	// tells objects apart the way basic alias analysis does: distinct identified objects never 
+	// alias, neither do function's own locals and its arguments.
+	static bool mayAlias(const Value *a, const Value *b) {
+		if (a == b) { return true; }
+		if (isIdentifiedObject(a) && isIdentifiedObject(b)) { return false; }
+		if (isIdentifiedFunctionLocal(a) && isa<Argument>(b)) { return false; }
+		if (isIdentifiedFunctionLocal(b) && isa<Argument>(a)) { return false; }
+		return true;
+	}
+
+	// restrict, nonnull and alignment of inputs, which the extractor puts on parameters of the 
+	// extracted function. values[i] are the input values of variables[i]. An input is restrict
+	// if what it reaches cannot alias anything reached by other inputs, nor is referenced by the
+	// region other than through the input, i.e. a global the pointer points to. Regions making 
+	// calls get no restrict, callees might reach the same memory some other way.
+	static void findPointerFacts(const DebugInfoIndex& DI,
+								 const BlockInfo& blockinfo,
+								 const RegionDesc& R,
+								 const std::vector<SmallVector<Value *, 1>>& values,
+								 std::vector<VariableInfo>& variables) {
+		const DataLayout& DL = DI.M->getDataLayout();
+		std::vector<InputTargets> targets(variables.size());
+		for (unsigned i = 0; i < variables.size(); i++) {
+			for (Value *V: values[i]) { findInputTargets(DL, V, targets[i]); }
+			if (!targets[i].pointer || variables[i].isfunptr) { continue; }
+
+			variables[i].isnonnull = targets[i].complete && targets[i].nonnull;
+			Type *pointee = targets[i].pointee;
+			if (targets[i].complete && pointee->isSized() && targets[i].align > DL.getABITypeAlignment(pointee)) { 
+				variables[i].pointeralign = targets[i].align; 
+			}
+		}
+
+		// objects pointer operands of region's instructions are based on.
+		DenseSet<const Value *> referenced;
+		for (int i = R.members.find_first(); i != -1; i = R.members.find_next(i))
+		for (Instruction& I: blockinfo.blocks[i]->getInstList()) {
+			if ((isa<CallInst>(&I) || isa<InvokeInst>(&I)) && !isa<IntrinsicInst>(&I)) { return; }
+			for (Value *op: I.operands()) {
+				if (!op->getType()->isPointerTy()) { continue; }
+				SmallVector<Value *, 4> objects;
+				GetUnderlyingObjects(op, objects, DL);
+				referenced.insert(objects.begin(), objects.end());
+			}
+		}
+
+		for (unsigned i = 0; i < variables.size(); i++) {
+			if (values[i].empty() || variables[i].isfunptr || !targets[i].complete || targets[i].objects.empty()) { continue; }
+
+			// uses of input's storage and of values bound to it in optimized code go through the input.
+			// Globals are referenced by name, their uses can not be told apart.
+			SmallPtrSet<const Value *, 4> own;
+			if (targets[i].storage) { own.insert(targets[i].storage); }
+			for (Value *V: values[i]) {
+				if (auto *a = dyn_cast<DbgValueInst>(V)) { V = a->getValue(); }
+				if (V && !isa<GlobalValue>(V)) { own.insert(V); }
+			}
+			bool restrict = true;
+			for (const Value *a: targets[i].objects) {
+				if (!own.count(a) && referenced.count(a)) { restrict = false; break; }
+			}
+			for (unsigned j = 0; j < variables.size() && restrict; j++) {
+				if (j == i || values[j].empty() || variables[j].isfunptr) { continue; }
+				if (!targets[j].complete) { restrict = false; break; }
+				for (const Value *a: targets[i].objects) {
+					if (targets[j].storage && mayAlias(a, targets[j].storage)) { restrict = false; break; }
+					for (const Value *b: targets[j].objects) { if (mayAlias(a, b)) { restrict = false; break; } }
+					if (!restrict) { break; }
+				}
+			}
+			variables[i].isrestrict = restrict;
+		}
+	}
+
+	// memory effects of the extracted function. Extractor copies inputs into parameters and declares 
+	// outputs and variables of the region itself, so accesses to their storage stay inside the function
+	// unless their address is taken. Arrays and pointers coming in reach argument memory, anything 
+	// else is memory of the program. Calls are judged by their own attributes.
+	static void findMemoryEffects(const DebugInfoIndex& DI,
+								  const BlockInfo& blockinfo,
+								  const RegionDesc& R,
+								  const AreaLoc& regionloc,
+								  const DenseSet<Value *>& inputs,
+								  const DenseSet<Value *>& outputs,
+								  const DenseSet<Value *>& locals,
+								  RegionRecord& record) {
+		const DataLayout& DL = DI.M->getDataLayout();
+
+		// pointers parameters come with: bound values of optimized code and loads of pointer allocas.
+		DenseSet<Value *> argvalues;
+		DenseSet<Value *> pointerstorage;
+		for (Value *V: inputs) {
+			if (locals.count(V)) { continue; }
+			if (auto *a = dyn_cast<DbgValueInst>(V)) { V = a->getValue(); }
+			if (!V || !V->getType()->isPointerTy()) { continue; }
+			if (auto *a = dyn_cast<AllocaInst>(V)) { if (a->getAllocatedType()->isPointerTy()) { pointerstorage.insert(V); } }
+			else if (!isa<GlobalVariable>(V)) { argvalues.insert(V); }
+		}
+
+		enum Kind { Own, ArgMemory, Outside };
+		auto classify = [&](Value *O, bool write) -> Kind {
+			if (auto *load = dyn_cast<LoadInst>(O)) { return pointerstorage.count(load->getPointerOperand()) ? ArgMemory : Outside; }
+			if (argvalues.count(O)) { return ArgMemory; }
+
+			Type *storage = nullptr;
+			if (auto *a = dyn_cast<AllocaInst>(O)) { storage = a->getAllocatedType(); }
+			if (auto *a = dyn_cast<GlobalVariable>(O)) { 
+				if (a->isConstant() && !write) { return Own; }
+				storage = a->getValueType(); 
+			}
+			if (!storage) { return Outside; }
+
+			if (inputs.count(O) && !locals.count(O) && storage->isArrayTy()) { return ArgMemory; }
+			Metadata *M = getMetadata(DI, O);
+			bool own = inputs.count(O) || outputs.count(O) || (isa<AllocaInst>(O) && (!M || declaredInArea(M, regionloc)));
+			return own && !PointerMayBeCaptured(O, true, true) ? Own : Outside;
+		};
+
+		bool reads = false, writes = false, outside = false;
+		auto access = [&](Value *P, bool write) {
+			SmallVector<Value *, 4> objects;
+			GetUnderlyingObjects(P, objects, DL);
+			for (Value *O: objects) {
+				Kind kind = classify(O, write);
+				if (kind == Own) { continue; }
+				reads = reads || !write;
+				writes = writes || write;
+				outside = outside || kind == Outside;
+			}
+		};
+		auto unknown = [&](bool write) { reads = true; writes = writes || write; outside = true; };
+
+		for (int i = R.members.find_first(); i != -1; i = R.members.find_next(i))
+		for (Instruction& I: blockinfo.blocks[i]->getInstList()) {
+			if (!I.mayReadOrWriteMemory()) { continue; }
+			if (auto *load = dyn_cast<LoadInst>(&I)) {
+				if (load->isUnordered()) { access(load->getPointerOperand(), false); } 
+				else { unknown(true); }
+				continue;
+			}
+			if (auto *store = dyn_cast<StoreInst>(&I)) {
+				if (store->isUnordered()) { access(store->getPointerOperand(), true); } 
+				else { unknown(true); }
+				continue;
+			}
+			if (auto *call = dyn_cast<CallInst>(&I)) {
+				if (call->doesNotAccessMemory()) { continue; }
+				bool write = !call->onlyReadsMemory();
+				if (!call->onlyAccessesArgMemory()) { unknown(write); continue; }
+				for (unsigned j = 0; j < call->getNumArgOperands(); j++) {
+					Value *arg = call->getArgOperand(j);
+					if (!arg->getType()->isPointerTy()) { continue; }
+					access(arg, false);
+					if (write) { access(arg, true); }
+				}
+				continue;
+			}
+			unknown(I.mayWriteToMemory());
+		}
+
+		record.readnone = !reads && !writes;
+		record.readonly = !writes;
+		record.argmemonly = !outside;
+	}
+
+	// compares M's line parameter to AreaLoc, returns true if number is between.
+	static bool declaredInArea(Metadata *M, const AreaLoc& A) {
+		unsigned linenum = std::numeric_limits<unsigned>::max();
+		if (auto *a = dyn_cast<DIGlobalVariable>(M)) { linenum = a->getLine(); }
+		if (auto *a  = dyn_cast<DILocalVariable>(M)) { linenum = a->getLine(); }
+		if (linenum == std::numeric_limits<unsigned>::max()) { return false; }
+		return (A.first <= linenum && linenum <= A.second);
+	}
+
+	// debug info also tells us if given alloca istruction is used for storing function
+	// arguments. Convenient as we don't need to manually look for matching AllocaInst. 
+	static bool isArgument(const DebugInfoIndex& DI, Value *V) {
+		auto it = DI.locals.find(V);
+		if (it == DI.locals.end()) { return false; }
+		DILocalVariable *DLV = it->second;
+		return (DLV->getArg() != 0);
+	}
+
+	std::string TypeDeclarator::print(StringRef name) const {
+		std::string out = parts[0];
+		for (unsigned i = 1; i < parts.size(); i++) { out.append(name.data(), name.size()).append(parts[i]); }
+		return out;
+	}
+
+	// decomposes the type into C declarator. Follows the pointers as necessary. Function 
+	// pointers have to be treated slightly differently, in that case the name goes inside of
+	// the declarator, same as for arrays.
+	// Every qualifier wraps everything found before it, text in front of it going to the left
+	// and array sizes going to the right. Left hand sides are therefore written innermost first, 
+	// right hand sides outermost first, so the whole declarator is written front to back.
+	static std::unique_ptr<TypeDeclarator> buildDeclarator(const DebugInfoIndex& DI, DIType *T) {
+		std::vector<unsigned> tags;
+		std::vector<DINodeArray> ranges; // for array size indexes
+
+		Metadata *md = cast<Metadata>(T);
+		while (true) {
+			// do not need to look for anymore.
+			if (isa<DIBasicType>(md))      { break; }
+			if (isa<DISubroutineType>(md)) { break; }
+
+			// we are interested in array type. 
+			if (auto a = dyn_cast<DICompositeType>(md)) {
+				auto t = a->getTag();
+				if (t == dwarf::DW_TAG_array_type)       { tags.push_back(t); ranges.push_back(a->getElements()); }
+				if (t == dwarf::DW_TAG_structure_type)   { tags.push_back(t); break; }
+				if (t == dwarf::DW_TAG_union_type)       { tags.push_back(t); break; }
+				if (t == dwarf::DW_TAG_enumeration_type) { tags.push_back(t); break; }
+				Metadata *next = a->getBaseType();
+				if (next == nullptr)  { break; } // no basetype property here, bailing
+				md = next; 
+				continue;
+			}
+ 
+			if (auto a = dyn_cast<DIDerivedType>(md)) {
+				auto t = a->getTag();
+				if (t == dwarf::DW_TAG_pointer_type) { tags.push_back(t); }
+				if (t == dwarf::DW_TAG_const_type  ) { tags.push_back(t); }
+				if (t == dwarf::DW_TAG_typedef     ) { tags.push_back(t); break; }
+				Metadata *next = a->getBaseType();
+				if (next == nullptr)  { break; } // no basetype property here, bailing
+				md = next;
+			}
+
+		}
+
+		DIType *type = cast<DIType>(md);
+		std::unique_ptr<TypeDeclarator> ret(new TypeDeclarator());
+		std::string current; // part being written.
+		if (tags.size() != 0 && tags[0] == dwarf::DW_TAG_const_type) { ret->isconstq = true; }
+
+		// function pointers: return type ( qualifiers name ) ( argument types ).
+		// First argument in DISubroutineArray is return type, the rest are arguments' types.
+		if (auto *a = dyn_cast<DISubroutineType>(md)) {
+			const auto& types = a->getTypeArray();
+			Metadata *rettypeinfo = types[0];
+			if (rettypeinfo == nullptr) { current += "void "; }  // void function
+			else { current += getDeclarator(DI, cast<DIType>(rettypeinfo)).print(""); }
+
+			// is function pointer constant or/and actually a pointer?
+			current += "( ";
+			for (auto it = tags.rbegin(); it != tags.rend(); ++it) {
+				if (*it == dwarf::DW_TAG_pointer_type) { current += " * "; }
+				if (*it == dwarf::DW_TAG_const_type)   { current += " const "; }
+			}
+			ret->parts.push_back(current);
+
+			// get function's arguments' types
+			current = " )(";
+			if (types.size() == 1) { current += "void"; } // we have 0 input arguments...
+			for (unsigned i = 1; i < types.size(); i++) {
+				if (i > 1) { current += ", "; }
+				current += getDeclarator(DI, cast<DIType>(types[i])).print("");
+			}
+			current += ")";
+			ret->parts.push_back(current);
+			ret->isfunptr = true;
+			ret->typehasname = true;
+			return ret; 
+		}
+
+		// depending on the type, we might need to add basetype name before or after 
+		bool baseTypeAdded = false;
+		std::string baseType = (type->getName().size() == 0) ? " void " : " " + type->getName().str() + " ";
+		for (unsigned& t: tags) {
+			switch (t) {
+				case dwarf::DW_TAG_structure_type:   
+				case dwarf::DW_TAG_union_type:       
+				case dwarf::DW_TAG_enumeration_type: 
+				case dwarf::DW_TAG_typedef:          { baseTypeAdded = true; break; }
+			}
+		}
+		if (!baseTypeAdded) { current += baseType; }
+
+		for (auto it = tags.rbegin(); it != tags.rend(); ++it) {
+			switch (*it) {
+				case dwarf::DW_TAG_pointer_type:     { current += " * "; break; }
+				case dwarf::DW_TAG_structure_type:   { current += "struct" + baseType; break; }
+				case dwarf::DW_TAG_union_type:       { current += "union"  + baseType; break; }
+				case dwarf::DW_TAG_enumeration_type: { current += "enum "  + baseType; break; }
+				case dwarf::DW_TAG_typedef:          { current += baseType; break; }
+				case dwarf::DW_TAG_const_type:       { current += "const "; break; }
+				case dwarf::DW_TAG_array_type:       { current += " ( "; break; }
+			}
+		}
+
+		// array sizes, outer arrays take ranges collected last.
+		for (unsigned& t: tags) {
+			if (t != dwarf::DW_TAG_array_type) { continue; }
+			ret->typehasname = true;
+			current += " ";
+			ret->parts.push_back(current);
+			current = " ) ";
+			DINodeArray rangelist = ranges.back(); ranges.pop_back();
+			for (auto elem = rangelist.begin(); elem != rangelist.end(); ++elem) {
+				if (auto a = cast<DISubrange>(*elem)) {
+					current += " [" + std::to_string(a->getCount()) + "] ";
+				}
+			}
+		}
+		ret->parts.push_back(current);
+
+		// const qualified variables and arrays do not have to be restored.
+		if (tags.size() != 0 && tags[0] == dwarf::DW_TAG_array_type) { ret->isarrayt = true; }
+		return ret; 
+	}
+
+	// declarators are built outside of the lock, as building one looks up others. If two threads
+	// happen to build the same one, the first one wins.
+	static const TypeDeclarator& getDeclarator(const DebugInfoIndex& DI, DIType *T) {
+		TypeCache& cache = DI.types;
+		{
+			std::lock_guard<std::mutex> guard(cache.lock);
+			auto it = cache.types.find(T);
+			if (it != cache.types.end()) { return *it->second; }
+		}
+
+		std::unique_ptr<TypeDeclarator> declarator = buildDeclarator(DI, T);
+		std::lock_guard<std::mutex> guard(cache.lock);
+		std::unique_ptr<TypeDeclarator>& entry = cache.types[T];
+		if (!entry) { entry = std::move(declarator); }
+		return *entry;
+	}
+
+	// extracts the type of the provided debuginfo type as a string, with variable name 
+	// included where C syntax needs it (typehasname).
+	static VariableInfo getTypeString(const DebugInfoIndex& DI, DIType *T, StringRef variablename) {
+		const TypeDeclarator& declarator = getDeclarator(DI, T);
+		VariableInfo ret = {"", "", false, false, false, false, false};
+		ret.type = declarator.print(variablename);
+		ret.typehasname = declarator.typehasname;
+		ret.isfunptr = declarator.isfunptr;
+		ret.isconstq = declarator.isconstq;
+		ret.isarrayt = declarator.isarrayt;
+		return ret;
+	}
+
+	// self-explanatory. 
+	static std::string getFunctionReturnType(const DebugInfoIndex& DI, const Function *F) {
+		DISubprogram *SP = cast<DISubprogram>(F->getMetadata(0));
+		if (auto *ST = dyn_cast<DISubroutineType>(SP->getRawType())) {
+			Metadata *M = ST->getTypeArray()[0];
+			if (!M) { return std::string("void"); }
+			return getDeclarator(DI, cast<DIType>(M)).print("");
 		}
 
 		return std::string("unknown");
 	}
 
-	static VariableInfo getVariableInfo(Value *V) {
-		Metadata *M = getMetadata(V);
+	// size and alignment the extractor plans argument passing with. Storage of the variable
+	// knows both, values of optimized code only carry debug info size, and their IR type may 
+	// be just a part of the variable, in which case alignment stays unknown.
+	static void getVariableLayout(const DebugInfoIndex& DI, Value *V, DIType *T, VariableInfo& info) {
+		const DataLayout& DL = DI.M->getDataLayout();
+		Type *storage = nullptr;
+		unsigned align = 0;
+		if (auto *a = dyn_cast<AllocaInst>(V))     { storage = a->getAllocatedType(); align = a->getAlignment(); }
+		if (auto *a = dyn_cast<GlobalVariable>(V)) { storage = a->getValueType(); align = a->getAlignment(); }
+		if (storage && storage->isSized()) {
+			info.size = DL.getTypeAllocSize(storage);
+			info.align = align ? align : DL.getABITypeAlignment(storage);
+			return;
+		}
+
+		// values may come as the dbg.value describing them.
+		if (auto *a = dyn_cast<DbgValueInst>(V)) { if (Value *value = a->getValue()) { V = value; } }
+
+		// typedefs and qualifiers have no size of their own.
+		Metadata *md = T;
+		while (auto *a = dyn_cast_or_null<DIDerivedType>(md)) {
+			if (a->getSizeInBits() != 0) { break; }
+			md = a->getBaseType();
+		}
+		if (auto *type = dyn_cast_or_null<DIType>(md)) {
+			info.size = type->getSizeInBits() / 8;
+			info.align = type->getAlignInBits() / 8;
+		}
+		if (!info.align && info.size && V->getType()->isSized() && DL.getTypeAllocSize(V->getType()) == info.size) {
+			info.align = DL.getABITypeAlignment(V->getType());
+		}
+	}
+
+	static VariableInfo getVariableInfo(const DebugInfoIndex& DI, Value *V) {
+		Metadata *M = getMetadata(DI, V);
 		if (!M) { return {"", "", false, false, false, false}; }
-		DIVariable *DI = cast<DIVariable>(M);
-		auto varinfo = getTypeString(cast<DIType>(DI->getRawType()), DI->getName());
-		varinfo.name = DI->getName().str();
+		DIVariable *DV = cast<DIVariable>(M);
+		auto varinfo = getTypeString(DI, cast<DIType>(DV->getRawType()), DV->getName());
+		varinfo.name = DV->getName().str();
+		getVariableLayout(DI, V, cast<DIType>(DV->getRawType()), varinfo);
 
-		// variable is static. 
+		// variable is static, i.e. declared inside function body, same as DebugInfoIndex::isStatic.
 		if (auto *a = dyn_cast<GlobalVariable>(V)) {
-			if (!a->isConstant() && a->hasInternalLinkage()) { varinfo.isstatic = true; }
+			if (!a->isConstant() && dyn_cast_or_null<DILocalScope>(DV->getScope())) { varinfo.isstatic = true; }
 		}
 
 		return varinfo;
 	}
 	
-	static void writeVariableInfo(VariableInfo& info, bool isOutputVar, std::ofstream& out) {
-		if (info.name.length() == 0) { return; }
-		out << XMLOpeningTag("variable", 1);
-		out << XMLElement("name", info.name, 2);
-		out << XMLElement("type", info.type, 2);
-		if (isOutputVar)      { out << XMLElement("isoutput", true, 2);    }
-		if (info.typehasname) { out << XMLElement("typehasname", true, 2); }
-		if (info.isfunptr) { out << XMLElement("isfunptr", true, 2); }
-		if (info.isconstq) { out << XMLElement("isconstq", true, 2); }
-		if (info.isstatic) { out << XMLElement("isstatic", true, 2); }
-		if (info.isarrayt) { out << XMLElement("isarrayt", true, 2); }
-		out << XMLClosingTag("variable", 1);
-	}
-
-	static void writeLocInfo(AreaLoc& loc, const char *tag, std::ofstream& out) {
-		out << XMLOpeningTag(tag, 1); 
-		out << XMLElement("start", loc.first, 2);
-		out << XMLElement("end",  loc.second, 2);
-		out << XMLClosingTag(tag, 1); 
+	static void writeVariableInfo(const VariableInfo& info, raw_ostream& out) {
+		XMLOpeningTag(out, "variable", 1);
+		XMLElement(out, "name", info.name, 2);
+		XMLElement(out, "type", info.type, 2);
+		if (info.isoutput)    { XMLElement(out, "isoutput", true, 2);    }
+		if (info.typehasname) { XMLElement(out, "typehasname", true, 2); }
+		if (info.isfunptr) { XMLElement(out, "isfunptr", true, 2); }
+		if (info.isconstq) { XMLElement(out, "isconstq", true, 2); }
+		if (info.isstatic) { XMLElement(out, "isstatic", true, 2); }
+		if (info.isarrayt) { XMLElement(out, "isarrayt", true, 2); }
+		if (info.ismodified) { XMLElement(out, "ismodified", true, 2); }
+		if (info.islocal)    { XMLElement(out, "islocal", true, 2);    }
+		if (info.isrestrict) { XMLElement(out, "isrestrict", true, 2); }
+		if (info.isnonnull)  { XMLElement(out, "isnonnull", true, 2);  }
+		if (info.size)  { XMLElement(out, "size", info.size, 2);   }
+		if (info.align) { XMLElement(out, "align", info.align, 2); }
+		if (info.pointeralign) { XMLElement(out, "pointeralign", info.pointeralign, 2); }
+		for (int i : info.liveexits) { XMLElement(out, "liveexit", i, 2); }
+		XMLClosingTag(out, "variable", 1);
+	}
+
+	static void writeLocInfo(const AreaLoc& loc, const char *tag, raw_ostream& out) {
+		XMLOpeningTag(out, tag, 1); 
+		XMLElement(out, "start", loc.first, 2);
+		XMLElement(out, "end",  loc.second, 2);
+		XMLClosingTag(out, tag, 1); 
 	}
 
 											 
+	// everything about a variable that ends up in the record.
+	static void describeVariable(const DebugInfoIndex& DI, Metadata *M, raw_ostream& out) {
+		auto *var = dyn_cast_or_null<DIVariable>(M);
+		if (!var) { out << "<none>"; return; }
+		VariableInfo info = getTypeString(DI, cast<DIType>(var->getRawType()), var->getName());
+		out << var->getName() << ':' << var->getLine() << ':' << info.type << ':' 
+			<< info.typehasname << info.isfunptr << info.isconstq << info.isarrayt;
+		if (auto *local = dyn_cast<DILocalVariable>(var)) { out << ':' << local->getArg(); }
+	}
+
+	static std::string getMD5(StringRef data) {
+		MD5 hash;
+		hash.update(data);
+		MD5::MD5Result result;
+		hash.final(result);
+		SmallString<32> hex;
+		MD5::stringifyResult(result, hex);
+		return hex.str().str();
+	}
+
+	// locals are numbered by their position in the function, so names of unrelated values
+	// and metadata numbering of the rest of the module do not affect the fingerprint.
+	static void fingerprintOperand(const DebugInfoIndex& DI, const DenseMap<const Value *, unsigned>& number, 
+								   Value *V, raw_ostream& out) {
+		if (auto *MAV = dyn_cast<MetadataAsValue>(V)) {
+			Metadata *M = MAV->getMetadata();
+			if (auto *VAM = dyn_cast<ValueAsMetadata>(M)) { fingerprintOperand(DI, number, VAM->getValue(), out); }
+			else if (isa<DIVariable>(M)) { describeVariable(DI, M, out); }
+			else { out << "!md"; }
+			return;
+		}
+
+		auto it = number.find(V);
+		if (it != number.end()) { out << '%' << it->second; return; }
+		if (auto *G = dyn_cast<GlobalVariable>(V)) {
+			out << '@' << G->getName() << ':' << G->isConstant() << G->hasInternalLinkage() << ':' << G->getAlignment() << ':';
+			describeVariable(DI, getMetadata(DI, V), out);
+			return;
+		}
+		if (auto *C = dyn_cast<Constant>(V)) { C->printAsOperand(out, true); return; }
+		out << '?';
+	}
+
+	// memory effects and pointer facts of calls come from attributes of the call and the callee.
+	static void fingerprintAttributes(const AttributeSet& attrs, unsigned args, raw_ostream& out) {
+		out << " [" << attrs.getAsString(AttributeSet::FunctionIndex) << '|' << attrs.getAsString(AttributeSet::ReturnIndex);
+		for (unsigned i = 0; i < args; i++) { out << '|' << attrs.getAsString(i + 1); }
+		out << ']';
+	}
+
+	// stable hash of everything region analysis looks at: instructions, their attributes and debug locations,
+	// debug info and alignment of variables, statics, the return type and attributes of the function.
+	static std::string fingerprintFunction(const DebugInfoIndex& DI, Function *F) {
+		DenseMap<const Value *, unsigned> number;
+		for (Argument& A: F->args()) { number.insert(std::make_pair(&A, number.size())); }
+		for (BasicBlock& BB: F->getBasicBlockList()) {
+			number.insert(std::make_pair(&BB, number.size()));
+			for (Instruction& I: BB.getInstList()) { number.insert(std::make_pair(&I, number.size())); }
+		}
+
+		SmallString<4096> buffer;
+		raw_svector_ostream out(buffer);
+		out << F->getName() << ':' << getFunctionReturnType(DI, F);
+		if (DISubprogram *SP = F->getSubprogram()) { out << ':' << SP->getLine(); }
+		// noalias / nonnull / align of parameters decide pointer facts of inputs.
+		fingerprintAttributes(F->getAttributes(), F->arg_size(), out);
+		out << '\n';
+
+		// statics are variables of every region even when the function does not use them.
+		for (GlobalVariable *G: DI.getStatics(F)) {
+			out << "static ";
+			fingerprintOperand(DI, number, G, out);
+			if (G->isConstant() && G->hasInitializer()) { out << ' '; fingerprintOperand(DI, number, G->getInitializer(), out); }
+			out << '\n';
+		}
+
+		for (BasicBlock& BB: F->getBasicBlockList()) {
+			out << BB.getName() << ":\n";
+			for (Instruction& I: BB.getInstList()) {
+				out << I.getOpcodeName() << ' ';
+				I.getType()->print(out);
+				for (Value *op: I.operand_values()) { 
+					out << ' ';
+					fingerprintOperand(DI, number, op, out); 
+				}
+				if (auto *alloca = dyn_cast<AllocaInst>(&I)) { out << " align " << alloca->getAlignment(); }
+				Function *callee = nullptr;
+				if (auto *call = dyn_cast<CallInst>(&I)) { 
+					fingerprintAttributes(call->getAttributes(), call->getNumArgOperands(), out);
+					callee = call->getCalledFunction();
+				}
+				if (auto *invoke = dyn_cast<InvokeInst>(&I)) { 
+					fingerprintAttributes(invoke->getAttributes(), invoke->getNumArgOperands(), out);
+					callee = invoke->getCalledFunction();
+				}
+				if (callee) { fingerprintAttributes(callee->getAttributes(), callee->arg_size(), out); }
+				if (const DebugLoc& loc = I.getDebugLoc()) { out << " !" << loc.getLine() << ':' << loc.getCol(); }
+				out << '\n';
+			}
+		}
+
+		return getMD5(buffer);
+	}
+
+	// cache key of the region also covers options which change the result, and the data layout 
+	// variable sizes come from.
+	static std::string getCacheKey(const FunctionContext& context, BasicBlock *entry, BasicBlock *exit) {
+		SmallString<128> buffer;
+		raw_svector_ostream out(buffer);
+		out << "v7:" << context.fingerprint << ':' << entry->getName() << ':' << (exit ? exit->getName() : "<FunctionReturn>")
+			<< ':' << (unsigned)Engine << ':' << (bool)Liveness << ':' << entry->getModule()->getDataLayoutStr();
+
+		return getMD5(buffer);
+	}
+
+	static std::shared_ptr<RegionRecord> loadCachedRecord(const std::string& key) {
+		ErrorOr<std::unique_ptr<MemoryBuffer>> buffer = MemoryBuffer::getFile(CacheDirectory + "/" + key + ".bin");
+		if (!buffer) { return nullptr; }
+		std::shared_ptr<RegionRecord> record(new RegionRecord());
+		if (!readBinaryRecord((*buffer)->getBuffer(), *record)) { return nullptr; }
+		NumRecordHits++;
+		return record;
+	}
+
+	// records are written to a temporary file first, so concurrent runs never see half-written ones.
+	static void storeCachedRecord(const std::string& key, const RegionRecord& record) {
+		SmallString<1024> buffer;
+		raw_svector_ostream bufferstream(buffer);
+		BinaryRecordWriter writer;
+		writer.write(record, bufferstream);
+
+		int fd;
+		SmallString<128> temp;
+		if (sys::fs::createUniqueFile(CacheDirectory + "/" + key + "-%%%%%%.tmp", fd, temp)) { return; }
+		{
+			raw_fd_ostream out(fd, true);
+			out << buffer;
+		}
+		if (sys::fs::rename(temp, CacheDirectory + "/" + key + ".bin")) { sys::fs::remove(temp); }
+	}
+
+	// makes sure debug info index and function context are up to date. Both drivers go through 
+	// all regions of a function before moving on to the next one, so this is done once per function.
+	static void prepareFunction(DebugInfoIndex& debuginfo, FunctionContext& context, Function *F) {
+		if (debuginfo.M != F->getParent()) { debuginfo.reset(F->getParent()); }
+		debuginfo.indexFunction(F);
+		if (context.F != F) { context.reset(debuginfo, F); }
+	}
+
+	static RegionDesc describeRegion(const DebugInfoIndex& debuginfo, FunctionContext& context, Region *R) {
+		RegionDesc desc;
+		desc.entry = R->getEntry();
+		desc.exit = R->getExit();
+		desc.toplevel = R->isTopLevelRegion();
+
+		if (!CacheDirectory.empty()) {
+			desc.cachekey = getCacheKey(context, desc.entry, desc.exit);
+			desc.cached = loadCachedRecord(desc.cachekey);
+			if (desc.cached) { return desc; }
+		}
+
+		if (!context.analysed) { context.analyse(debuginfo); }
+		desc.members = context.blocks.getMembers(R);
+
+		if (Engine == SummaryEngine) {
+			if (context.summaries.uses.count(R) == 0) { summarizeRegions(debuginfo, context, R); }
+			desc.uses = context.summaries.uses[R];
+		}
+
+		return desc;
+	}
+
+	// finds inputs / outputs of the region and collects everything that goes into the output.
+	// Only reads the IR and context of region's own function, so regions of different functions 
+	// can be analysed at the same time.
+	static RegionRecord analyseRegion(const DebugInfoIndex& debuginfo, FunctionContext& context, const RegionDesc& R) {
+		if (R.cached) { 
+			RegionRecord record = *R.cached;
+			record.position = R.position;
+			return record; 
+		}
+		Function *F = context.F;
+		BlockInfo& blockinfo = context.blocks;
+		const BitVector& members = R.members;
+		AreaLoc regionBounds = getRegionLoc(context, members);
+		AreaLoc functionBounds = context.bounds;
+		DenseSet<int> regionExit = regionGetExitingLocs(context, members);
+		BitVector successors = collectSuccessorBasicBlocks(blockinfo, R);
+
+		DenseSet<Value *> inputargs;
+		DenseSet<Value *> outputargs;
+
+		DenseSet<Value *> inputprevious;
+		DenseSet<Value *> outputprevious;
+
+		// find inputs / outputs.
+		if (Engine == UsesEngine) {
+			findInputsOutputsByUses(debuginfo, context.candidates, functionBounds, regionBounds, context.constants, 
+									blockinfo, members, successors, inputargs, outputargs);
+		}
+
+		if (Engine == SummaryEngine) {
+			findInputsOutputsBySummary(debuginfo, context, regionBounds, R, successors, inputargs, outputargs);
+		}
+
+		if (Engine == ScanEngine) {
+			for (int i = members.find_first(); i != -1; i = members.find_next(i))
+			for (Instruction& I: blockinfo.blocks[i]->getInstList()) {
+				findInputs(debuginfo, &I, regionBounds, context.constants, context.slices, inputprevious, inputargs); 
+			}
+
+			for (int i = successors.find_first(); i != -1; i = successors.find_next(i))
+			for (Instruction& I: blockinfo.blocks[i]->getInstList()) {
+				findOutputs(debuginfo, &I, regionBounds, context.constants, context.slices, outputprevious, outputargs); 
+			}
+		}
+
+		DenseSet<Value *> modified;
+		DenseSet<Value *> locals;
+		DenseMap<Value *, std::vector<int>> liveexits;
+		if (Liveness) {
+			classifyByLiveness(debuginfo, context.liveness, blockinfo, R, inputargs, outputargs, modified, locals);
+			findLiveExits(context, R, modified, liveexits);
+		}
+		auto mergeLiveExits = [&](VariableInfo& info, Value *V) {
+			auto it = liveexits.find(V);
+			if (it == liveexits.end()) { return; }
+			std::vector<int> lines;
+			std::set_union(info.liveexits.begin(), info.liveexits.end(), it->second.begin(), it->second.end(), std::back_inserter(lines));
+			info.liveexits = std::move(lines);
+		};
+
+		RegionRecord record;
+		record.funcname = generateFilename(F, R.entry, R.exit);
+		record.region = regionBounds;
+		record.function = functionBounds;
+		record.returntype = getFunctionReturnType(debuginfo, F);
+		record.toplevel = R.toplevel;
+		record.liveness = Liveness;
+		record.position = R.position;
+		record.exits.assign(regionExit.begin(), regionExit.end());
+		std::sort(record.exits.begin(), record.exits.end());
+
+		// without allocas a variable may come with several values, one entry per variable is enough.
+		DenseMap<Metadata *, unsigned> seen;
+		std::vector<SmallVector<Value *, 1>> inputvalues; // by variable.
+		for (Value *V : inputargs)  { 
+			auto found = seen.find(getMetadata(debuginfo, V));
+			if (found != seen.end()) {
+				VariableInfo& info = record.variables[found->second];
+				info.ismodified = info.ismodified || modified.count(V);
+				info.islocal = info.islocal && locals.count(V);
+				mergeLiveExits(info, V);
+				inputvalues[found->second].push_back(V);
+				continue;
+			}
+			VariableInfo info = getVariableInfo(debuginfo, V);
+			if (info.name.empty()) { continue; }
+			info.ismodified = modified.count(V);
+			info.islocal = locals.count(V);
+			mergeLiveExits(info, V);
+			seen.insert(std::make_pair(getMetadata(debuginfo, V), record.variables.size()));
+			record.variables.push_back(info);
+			inputvalues.emplace_back(1, V);
+		}
+
+		for (Value *V : outputargs) { 
+			auto found = seen.find(getMetadata(debuginfo, V));
+			if (found != seen.end()) {
+				VariableInfo& info = record.variables[found->second];
+				info.ismodified = info.ismodified || modified.count(V);
+				mergeLiveExits(info, V);
+				continue;
+			}
+			VariableInfo info = getVariableInfo(debuginfo, V);
+			if (info.name.empty()) { continue; }
+			info.ismodified = modified.count(V);
+			info.isoutput = true;
+			mergeLiveExits(info, V);
+			seen.insert(std::make_pair(getMetadata(debuginfo, V), record.variables.size()));
+			record.variables.push_back(info);
+			inputvalues.emplace_back();
+		}
+		findPointerFacts(debuginfo, blockinfo, R, inputvalues, record.variables);
+		findMemoryEffects(debuginfo, blockinfo, R, regionBounds, inputargs, outputargs, locals, record);
+
+		// sets above have no stable order, cached and fresh records must look the same.
+		std::stable_sort(record.variables.begin(), record.variables.end(), 
+			[](const VariableInfo& a, const VariableInfo& b) {
+				return std::tie(a.isoutput, a.name, a.type) < std::tie(b.isoutput, b.name, b.type);
+			});
+
+		if (!R.cachekey.empty()) { storeCachedRecord(R.cachekey, record); }
+		return record;
+	}
+
+	// writes the record into its own file using selected format, file name starts with the prefix.
+	// In aggregated mode JSON records are already separated by newlines, XML and binary records
+	// are prefixed with their size in bytes followed by a newline.
+	static void writeRegionRecord(const RegionRecord& record, StringRef prefix) {
+		// batch driver writes records of many modules at once.
+		static std::mutex lock;
+		std::lock_guard<std::mutex> guard(lock);
+		RecordWriter& writer = getRecordWriter();
+		if (Aggregate || OutDirectory == "-") {
+			raw_ostream *out = getAggregateStream();
+			if (!out) { return; }
+			if (!Shard.empty()) { *out << "#order " << record.position.first << ' ' << record.position.second << '\n'; }
+			if (Format == JSONFormat) { 
+				writer.write(record, *out); 
+				return;
+			}
+
+			static SmallString<4096> buffer;
+			buffer.clear();
+			raw_svector_ostream bufferstream(buffer);
+			writer.write(record, bufferstream);
+			*out << buffer.size() << '\n' << buffer;
+			return;
+		}
+
+		std::error_code EC;
+		std::string filename = OutDirectory + prefix.str() + record.funcname + writer.extension();
+		raw_fd_ostream outfile(filename, EC, sys::fs::F_None);
+		if (EC) {
+			errs() << "Could not open output file: " << EC.message() << "\n";
+			return;
+		}
+		writer.write(record, outfile);
+	}
+
+	// returns region with given entry / exit blocks, nullptr if there is none. Exit block is 
+	// nullptr for top level region. 
+	static Region * findRegion(RegionInfo& RI, BasicBlock *entry, BasicBlock *exit) {
+		for (Region *R = RI.getRegionFor(entry); R; R = R->getParent()) {
+			if (R->getEntry() == entry && R->getExit() == exit) { return R; }
+		}
+		return nullptr;
+	}
+
+	// all regions are in the only shard unless -funcextract-shard says otherwise.
+	static ShardSpec parseShard() {
+		ShardSpec shard;
+		if (Shard.empty()) { return shard; }
+		std::pair<StringRef, StringRef> parts = StringRef(Shard).split('/');
+		if (parts.first.getAsInteger(10, shard.index) || parts.second.getAsInteger(10, shard.count) || 
+			shard.count == 0 || shard.index >= shard.count) {
+			report_fatal_error("invalid -funcextract-shard, expected i/N with i < N");
+		}
+		return shard;
+	}
+
+	// regions are assigned to shards by FNV-1a hash of function and block names, which does
+	// not depend on the platform, the order of regions or anything else in the module.
+	static bool inShard(const ShardSpec& shard, Function *F, BasicBlock *entry, BasicBlock *exit) {
+		if (shard.count == 1) { return true; }
+
+		uint64_t hash = 14695981039346656037ULL;
+		auto update = [&](StringRef str) {
+			for (char c: str) { hash = (hash ^ (unsigned char)c) * 1099511628211ULL; }
+			hash = (hash ^ 0xff) * 1099511628211ULL; // separator
+		};
+		update(F->getName());
+		update(entry->getName());
+		update(exit ? exit->getName() : "<FunctionReturn>");
+		return hash % shard.count == shard.index;
+	}
+
+	// resolves selectors of the function against its region info. Regions come in the order 
+	// of selectors, each of them only once.
+	static void selectRegions(const RegionListIndex& regionlist, Function& F, RegionInfo& RI, std::vector<Region *>& out) {
+		std::vector<const RegionSelector *> selectors;
+		if (AllRegions || regionlist.everything) {
+			static const RegionSelector every = { RegionSelector::EveryRegion, "", "", AreaLoc() };
+			selectors.push_back(&every);
+		}
+		regionlist.getSelectors(F, selectors);
+
+		DenseSet<Region *> seen;
+		BlockLineIndex lines;
+		ValueSymbolTable *symbols = F.getValueSymbolTable();
+		for (const RegionSelector *selector: selectors) {
+			if (selector->kind == RegionSelector::EveryRegion) {
+				std::vector<Region *> stack(1, RI.getTopLevelRegion());
+				while (stack.size() != 0) {
+					Region *R = stack.back();
+					stack.pop_back();
+					if (seen.insert(R).second) { out.push_back(R); }
+					size_t last = stack.size();
+					for (auto& child: *R) { stack.push_back(child.get()); }
+					std::reverse(stack.begin() + last, stack.end()); // children in order.
+				}
+				continue;
+			}
+
+			// blocks on the lines may be spread over several regions, take the one containing all of them.
+			if (selector->kind == RegionSelector::LineRange) {
+				if (lines.blocks.empty()) { lines.reset(&F); }
+				SmallVector<BasicBlock *, 8> blocks;
+				lines.find(selector->lines, blocks);
+				if (blocks.empty()) { continue; }
+				Region *R = RI.getCommonRegion(blocks);
+				if (seen.insert(R).second) { out.push_back(R); }
+				continue;
+			}
+
+			BasicBlock *entry = dyn_cast_or_null<BasicBlock>(symbols->lookup(selector->entry));
+			BasicBlock *exit  = dyn_cast_or_null<BasicBlock>(symbols->lookup(selector->exit));
+			Region *R = entry ? findRegion(RI, entry, exit) : nullptr;
+			if (!R || (!exit && selector->exit != "<FunctionReturn>")) {
+				errs() << "Region " << selector->entry << " => " << selector->exit << " not found in " 
+					   << F.getName() << ", skipping...\n";
+				continue;
+			}
+			if (seen.insert(R).second) { out.push_back(R); }
+		}
+	}
+
 	struct FuncExtract : public RegionPass {
 		static char ID;
-		StringMap<StringSet<>> regionlist;
+		RegionListIndex regionlist;
+		DebugInfoIndex debuginfo;
+		FunctionContext context;
+		Function *current = nullptr;
+		unsigned regioncount = 0; // regions of current function visited so far.
+		DenseSet<Region *> selected; // listed regions of current function.
+		ShardSpec shard;
 		
-		FuncExtract() : RegionPass(ID) { readRegionFile(regionlist, BBListFilename); }
+		FuncExtract() : RegionPass(ID), shard(parseShard()) { regionlist.read(BBListFilename); }
 		~FuncExtract(void) { }
 
 		bool runOnRegion(Region *R, RGPassManager &RGM) override {
@@ -629,63 +2577,307 @@ namespace {
 				return false;
 			}
 
-			
-			if (!inRegionList(regionlist, F, R)) { return false; }
-			std::string outfilename = generateFilename(F, R);
-			AreaLoc regionBounds = getRegionLoc(R);
-			AreaLoc functionBounds = getFunctionLoc(F);
-			DenseSet<int> regionExit = regionGetExitingLocs(R);
+			if (F != current) { 
+				current = F; 
+				regioncount = 0; 
+				std::vector<Region *> regions;
+				selectRegions(regionlist, *F, *R->getRegionInfo(), regions);
+				selected.clear();
+				selected.insert(regions.begin(), regions.end());
+			}
+			unsigned index = regioncount++;
+			if (!selected.count(R)) { return false; }
+			if (!inShard(shard, F, R->getEntry(), R->getExit())) { return false; }
+			prepareFunction(debuginfo, context, F);
+			RegionDesc desc = describeRegion(debuginfo, context, R);
+			desc.position = std::make_pair(debuginfo.functions.lookup(F), index);
+			writeRegionRecord(analyseRegion(debuginfo, context, desc), "");
+			return false;
+		}
+	};
 
-			DenseSet<ValuePair> constants = findBasicConstants(F, functionBounds);
-			DenseSet<BasicBlock *> successors = collectSuccessorBasicBlocks(R);
+	// regions of a single function waiting to be analysed. Each work item has its own context,
+	// so work items never share any mutable state.
+	struct FunctionWork {
+		std::unique_ptr<FunctionContext> context;
+		std::vector<RegionDesc> regions;
+		std::vector<RegionRecord> records;
+	};
 
-			DenseSet<Value *> inputargs;
-			DenseSet<Value *> outputargs;
+	// analyses all work items on a number of threads and writes the results in the order work 
+	// items were collected. Threads pick the next unprocessed function as soon as they are done
+	// with the previous one, so a few huge functions do not hold up the rest.
+	static void analyseInParallel(const DebugInfoIndex& debuginfo, std::vector<FunctionWork>& work, unsigned numthreads,
+								  StringRef prefix) {
+		std::vector<unsigned> order;
+		for (unsigned i = 0; i < work.size(); i++) { order.push_back(i); }
+		std::stable_sort(order.begin(), order.end(), [&](unsigned a, unsigned b) { 
+			return work[a].context->blocks.blocks.size() > work[b].context->blocks.blocks.size(); 
+		});
+
+		std::atomic<unsigned> next(0);
+		auto worker = [&]() {
+			for (unsigned i = next++; i < order.size(); i = next++) {
+				FunctionWork& item = work[order[i]];
+				for (RegionDesc& desc: item.regions) { 
+					item.records.push_back(analyseRegion(debuginfo, *item.context, desc)); 
+				}
+			}
+		};
 
-			DenseSet<Value *> inputprevious;
-			DenseSet<Value *> outputprevious;
+		std::vector<std::thread> threads;
+		for (unsigned i = 1; i < numthreads; i++) { threads.push_back(std::thread(worker)); }
+		worker();
+		for (std::thread& t: threads) { t.join(); }
 
-			// find inputs / outputs.
-			for (BasicBlock *BB: R->blocks()) 
-			for (Instruction& I: BB->getInstList()) {
-				findInputs(&I, functionBounds, regionBounds, constants, inputprevious, inputargs); 
-			}
+		for (FunctionWork& item: work)
+		for (RegionRecord& record: item.records) { writeRegionRecord(record, prefix); }
+	}
 
-			for (BasicBlock *BB: successors)
-			for (Instruction& I: BB->getInstList()) {
-				findOutputs(&I, functionBounds, regionBounds, constants, outputprevious, outputargs); 
-			}
+	// region info is only computed for functions from the region list, see FuncExtract.h.
+	// Regions are looked up by their entry / exit blocks instead of comparing names of every 
+	// region in the module. With more than one thread, regions are first collected and then
+	// analysed concurrently.
+	struct FuncExtractModule : public ModulePass {
+		static char ID;
 
-			//write collected info using xml-like format
-			std::ofstream outfile;
-			outfile.open(OutDirectory + outfilename + ".xml", std::ofstream::out);
-			outfile << XMLOpeningTag("extractinfo", 0);
-			writeLocInfo(regionBounds, "region", outfile);
-			writeLocInfo(functionBounds, "function", outfile);
+		FuncExtractModule() : ModulePass(ID) { }
 
-			// dump variable info...
-			for (Value *V : inputargs)  { 
-				VariableInfo info = getVariableInfo(V);
-				writeVariableInfo(info , false, outfile); 
-			}
+		void getAnalysisUsage(AnalysisUsage &AU) const override {
+			AU.addRequired<RegionInfoPass>();
+			AU.setPreservesAll();
+		}
 
-			for (Value *V : outputargs) { 
-				VariableInfo info = getVariableInfo(V);
-				writeVariableInfo(info, true,  outfile); 
+		bool runOnModule(Module &M) override {
+			funcextract::RegionListExtractor extractor;
+			for (Function& F: M) {
+				if (!extractor.isListed(F)) { continue; }
+				extractor.extractFunction(F, getAnalysis<RegionInfoPass>(F).getRegionInfo());
 			}
+			extractor.finish();
+			return false;
+		}
+	};
+}
+
+struct funcextract::RegionList::Impl {
+	RegionListIndex index;
+};
+
+funcextract::RegionList::RegionList() : impl(new Impl()) { impl->index.read(BBListFilename); }
+
+funcextract::RegionList::~RegionList() { }
+
+struct funcextract::RegionListExtractor::Impl {
+	std::shared_ptr<const RegionList> list;
+	const RegionListIndex *regionlist; // owned by list.
+	DebugInfoIndex debuginfo;
+	FunctionContext context;
+	std::vector<FunctionWork> work;
+	unsigned numthreads;
+	unsigned regioncount; // regions of current function visited so far.
+	ShardSpec shard;
+	std::string prefix; // of output file names.
+
+	// analyses the region right away, or queues it up if we are running in parallel.
+	void extractRegion(FunctionContext& ctx, Region *R) {
+		unsigned index = regioncount++;
+		Function *F = R->getEntry()->getParent();
+		if (!inShard(shard, F, R->getEntry(), R->getExit())) { return; }
+		RegionDesc desc = describeRegion(debuginfo, ctx, R);
+		desc.position = std::make_pair(debuginfo.functions.lookup(F), index);
+		if (&ctx != &context) { work.back().regions.push_back(desc); return; }
+		writeRegionRecord(analyseRegion(debuginfo, ctx, desc), prefix);
+	}
+};
+
+funcextract::RegionListExtractor::RegionListExtractor() 
+	: RegionListExtractor(std::shared_ptr<const RegionList>(new RegionList())) { }
 
-			// dump region exit locs
-			for (int& i : regionExit)   { outfile << XMLElement("regionexit", i, 1); }
-			outfile << XMLElement("funcreturntype", getFunctionReturnType(F), 1);
-			outfile << XMLElement("funcname", outfilename, 1);
-			outfile << XMLElement("toplevel", R->isTopLevelRegion(), 1);
-			outfile << XMLClosingTag("extractinfo", 0);
-			outfile.close();
+funcextract::RegionListExtractor::RegionListExtractor(std::shared_ptr<const RegionList> list) : impl(new Impl()) { 
+	impl->list = list;
+	impl->regionlist = &list->impl->index;
+	impl->numthreads = Threads;
+	impl->shard = parseShard();
+	if (impl->numthreads == 0) { impl->numthreads = std::max(1u, std::thread::hardware_concurrency()); }
+}
+
+funcextract::RegionListExtractor::~RegionListExtractor() { }
+
+bool funcextract::RegionListExtractor::isParallel() const { return impl->numthreads > 1; }
+
+void funcextract::RegionListExtractor::setFilePrefix(const std::string& prefix) { impl->prefix = prefix; }
+
+bool funcextract::RegionListExtractor::isListed(const Function& F) const {
+	if (F.isDeclaration()) { return false; }
+	return AllRegions || impl->regionlist->isListed(F);
+}
+
+void funcextract::RegionListExtractor::extractFunction(Function& F, RegionInfo& RI) {
+	if (!F.hasMetadata()) { 
+		errs() << "Function is missing debug metadata, skipping...\n";
+		return;
+	}
+
+	// in parallel mode every function gets its own context which outlives region info.
+	FunctionContext *ctx = &impl->context;
+	if (isParallel()) {
+		impl->work.push_back(FunctionWork());
+		impl->work.back().context.reset(new FunctionContext());
+		ctx = impl->work.back().context.get();
+	}
+	prepareFunction(impl->debuginfo, *ctx, &F);
+	impl->regioncount = 0;
+
+	std::vector<Region *> regions;
+	selectRegions(*impl->regionlist, F, RI, regions);
+	for (Region *R: regions) { impl->extractRegion(*ctx, R); }
+}
 
+void funcextract::RegionListExtractor::releaseFunction(Function& F) {
+	impl->debuginfo.forgetFunction(&F);
+	if (impl->context.F == &F) { impl->context.F = nullptr; }
+}
+
+bool funcextract::RegionListExtractor::extractLazyModule(Module& M) {
+	std::vector<Function *> materialized;
+	for (Function& F: M) {
+		if (!isListed(F)) { continue; }
+		if (Error E = F.materialize()) {
+			logAllUnhandledErrors(std::move(E), errs(), "Could not read " + F.getName() + ": ");
 			return false;
 		}
+
+		// the same analyses RegionInfoPass would have built, just for this single function.
+		{
+			DominatorTree DT(F);
+			PostDominatorTree PDT;
+			PDT.recalculate(F);
+			DominanceFrontier DF;
+			DF.analyze(DT);
+			RegionInfo RI;
+			RI.recalculate(F, &DT, &PDT, &DF);
+			extractFunction(F, RI);
+		}
+
+		// in parallel mode regions are analysed at the very end, keep bodies around until then.
+		if (isParallel()) {
+			materialized.push_back(&F);
+			continue;
+		}
+		releaseFunction(F);
+		F.deleteBody();
+	}
+
+	finish();
+	for (Function *F: materialized) {
+		releaseFunction(*F);
+		F->deleteBody();
+	}
+	return true;
+}
+
+void funcextract::RegionListExtractor::finish() {
+	if (isParallel()) { analyseInParallel(impl->debuginfo, impl->work, impl->numthreads, impl->prefix); }
+	impl->work.clear();
+}
+
+struct funcextract::ModuleAnalyzer::Impl {
+	// everything RegionInfoPass would have built for the function, plus our own context.
+	struct FunctionState {
+		DominatorTree DT;
+		PostDominatorTree PDT;
+		DominanceFrontier DF;
+		RegionInfo RI;
+		FunctionContext context;
 	};
+
+	DebugInfoIndex debuginfo;
+	DenseMap<const Function *, std::unique_ptr<FunctionState>> functions;
+
+	FunctionState& getState(Function& F) {
+		std::unique_ptr<FunctionState>& state = functions[&F];
+		if (state) { return *state; }
+
+		state.reset(new FunctionState());
+		state->DT.recalculate(F);
+		state->PDT.recalculate(F);
+		state->DF.analyze(state->DT);
+		state->RI.recalculate(F, &state->DT, &state->PDT, &state->DF);
+		prepareFunction(debuginfo, state->context, &F);
+		if (!state->context.analysed) { state->context.analyse(debuginfo); }
+		return *state;
+	}
+
+	// smallest region covering the lines. Parents come first, so on ties the outer region wins,
+	// which for loops is the one including the loop header.
+	void findRegionForLines(FunctionContext& context, Region *R, const AreaLoc& lines, Region *&best, unsigned& bestsize) {
+		AreaLoc bounds = getRegionLoc(context, context.blocks.getMembers(R));
+		if (bounds.first > lines.first || bounds.second < lines.second) { return; }
+		if (bounds.second - bounds.first < bestsize) {
+			best = R;
+			bestsize = bounds.second - bounds.first;
+		}
+		for (auto& child: *R) { findRegionForLines(context, child.get(), lines, best, bestsize); }
+	}
+};
+
+funcextract::ModuleAnalyzer::ModuleAnalyzer(Module& M) : impl(new Impl()) { impl->debuginfo.reset(&M); }
+
+funcextract::ModuleAnalyzer::~ModuleAnalyzer() { }
+
+std::string funcextract::ModuleAnalyzer::getFingerprint(Function& F) {
+	impl->debuginfo.indexFunction(&F);
+	return fingerprintFunction(impl->debuginfo, &F);
+}
+
+bool funcextract::ModuleAnalyzer::analyzeRegion(Function& F, BasicBlock *entry, BasicBlock *exit, RegionRecord& record) {
+	if (F.isDeclaration() || !F.hasMetadata() || !entry || entry->getParent() != &F) { return false; }
+	Impl::FunctionState& state = impl->getState(F);
+	Region *R = findRegion(state.RI, entry, exit);
+	if (!R) { return false; }
+
+	RegionDesc desc = describeRegion(impl->debuginfo, state.context, R);
+	record = analyseRegion(impl->debuginfo, state.context, desc);
+	return true;
+}
+
+bool funcextract::ModuleAnalyzer::analyzeRegionForLines(Function& F, unsigned start, unsigned end, RegionRecord& record) {
+	if (F.isDeclaration() || !F.hasMetadata()) { return false; }
+	Impl::FunctionState& state = impl->getState(F);
+
+	Region *best = nullptr;
+	unsigned bestsize = std::numeric_limits<unsigned>::max();
+	impl->findRegionForLines(state.context, state.RI.getTopLevelRegion(), AreaLoc(start, end), best, bestsize);
+	if (!best) { return false; }
+
+	RegionDesc desc = describeRegion(impl->debuginfo, state.context, best);
+	record = analyseRegion(impl->debuginfo, state.context, desc);
+	return true;
+}
+
+bool funcextract::ModuleAnalyzer::writeRegionForLines(Function& F, unsigned start, unsigned end, raw_ostream& out) {
+	RegionRecord record;
+	if (!analyzeRegionForLines(F, start, end, record)) { return false; }
+	getRecordWriter().write(record, out);
+	return true;
+}
+
+void funcextract::ModuleAnalyzer::releaseFunction(Function& F) {
+	impl->functions.erase(&F);
+	impl->debuginfo.forgetFunction(&F);
 }
 
 char FuncExtract::ID = 0;
+char FuncExtractModule::ID = 0;
 static RegisterPass<FuncExtract> X("funcextract", "Func Extract", true, true);
+static RegisterPass<FuncExtractModule> Y("funcextract-module", "Func Extract (listed functions only)", true, true);
+
+// lets clang run -funcextract-module as part of a normal compile, skipping the textual IR 
+// round trip through opt. With optimizations the pass runs last, on the IR that is actually 
+// going to be compiled, where variables are found through llvm.dbg.value.
+static void addFuncExtractModule(const PassManagerBuilder&, legacy::PassManagerBase& PM) {
+	PM.add(new FuncExtractModule());
+}
+static RegisterStandardPasses Z(PassManagerBuilder::EP_EnabledOnOptLevel0, addFuncExtractModule);
+static RegisterStandardPasses Z2(PassManagerBuilder::EP_OptimizerLast, addFuncExtractModule);
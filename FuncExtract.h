@@ -0,0 +1,136 @@
+#ifndef FUNCEXTRACT_H
+#define FUNCEXTRACT_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+	class BasicBlock;
+	class Function;
+	class Module;
+	class RegionInfo;
+	class raw_ostream;
+}
+
+namespace funcextract {
+	typedef std::pair<unsigned,unsigned> AreaLoc; // first and last line.
+
+	struct VariableInfo { 
+		std::string name; 
+		std::string type; 
+		bool typehasname;  // sometimes we need to include variable name into the type definition.
+		bool isfunptr; 
+		bool isconstq; 
+		bool isstatic; 
+		bool isarrayt;
+		bool ismodified; // input is written inside the region and its value is needed afterwards.
+		bool islocal;    // input's value on region entry is never read.
+		bool isoutput;
+		bool isrestrict; // memory reached through the input is not reachable through any other input.
+		bool isnonnull;  // pointer or decayed array is never null.
+		uint64_t size;  // bytes, 0 if unknown.
+		unsigned align; // bytes, 0 if unknown.
+		std::vector<int> liveexits; // exits after which modified variable is still needed, by line.
+		unsigned pointeralign; // known alignment of what pointer points to, 0 unless above its type's.
+	};
+
+	// everything collected about a single region, ready to be written out.
+	struct RegionRecord {
+		std::string funcname; // also used as output file name.
+		AreaLoc region;
+		AreaLoc function;
+		std::vector<VariableInfo> variables;
+		std::vector<int> exits;
+		std::string returntype;
+		bool toplevel;
+		bool liveness; // variables carry ismodified / islocal flags.
+		bool readnone;   // extracted function reads and writes no memory but its own variables.
+		bool readonly;   // extracted function writes no memory but its own variables.
+		bool argmemonly; // all memory extracted function touches comes through its parameters.
+		std::pair<unsigned, unsigned> position; // function in module, region in function. Orders sharded output.
+	};
+
+	// parsed -bblist. It is never modified once read, so extractors running on different 
+	// threads can share one instead of reading the list again, see funcextract-batch.
+	class RegionList {
+	public:
+		RegionList();
+		~RegionList();
+
+	private:
+		friend class RegionListExtractor;
+		struct Impl;
+		std::unique_ptr<Impl> impl;
+	};
+
+	// writes info for regions listed in -bblist, one function at a time. Region info is only 
+	// needed while the function is being processed, so callers are free to build it themselves
+	// and throw it away right after. Used by -funcextract-module pass and funcextract tool.
+	class RegionListExtractor {
+	public:
+		RegionListExtractor();
+		explicit RegionListExtractor(std::shared_ptr<const RegionList>);
+		~RegionListExtractor();
+
+		// true if regions of the function have to be extracted. 
+		bool isListed(const llvm::Function&) const;
+
+		// writes info for listed regions of the function. In parallel mode regions are only 
+		// collected, and the function must stay intact until finish() is called.
+		void extractFunction(llvm::Function&, llvm::RegionInfo&);
+
+		// forgets everything about the function, so its body can be deleted.
+		void releaseFunction(llvm::Function&);
+
+		// analyses and writes regions collected in parallel mode.
+		void finish();
+
+		// materializes listed functions of a lazily loaded module one by one, builds their 
+		// region info and writes regions. Function bodies are deleted once done. Returns 
+		// false if a function could not be read. 
+		bool extractLazyModule(llvm::Module&);
+		bool isParallel() const;
+
+		// output file names start with the prefix, so extractors of different modules writing 
+		// into the same directory do not overwrite each other's regions. Empty by default.
+		void setFilePrefix(const std::string&);
+
+	private:
+		struct Impl;
+		std::unique_ptr<Impl> impl;
+	};
+
+	// answers queries about regions of a module that stays in memory. Region info and everything
+	// else computed for a function is kept until the function is released. Used by server mode
+	// of funcextract tool and the C API.
+	class ModuleAnalyzer {
+	public:
+		explicit ModuleAnalyzer(llvm::Module&);
+		~ModuleAnalyzer();
+
+		// hash of function's IR and debug info, same as used by -funcextract-cache.
+		std::string getFingerprint(llvm::Function&);
+
+		// finds inputs / outputs of the region with given entry and exit blocks. Exit is nullptr 
+		// for regions ending with function return. Returns false if there is no such region.
+		bool analyzeRegion(llvm::Function&, llvm::BasicBlock *, llvm::BasicBlock *, RegionRecord&);
+
+		// same as above, for the smallest region covering lines [start, end] of the function.
+		bool analyzeRegionForLines(llvm::Function&, unsigned, unsigned, RegionRecord&);
+
+		// writes record of the smallest region covering lines [start, end] of the function, 
+		// using -funcextract-format. Returns false if there is no such region.
+		bool writeRegionForLines(llvm::Function&, unsigned, unsigned, llvm::raw_ostream&);
+
+		void releaseFunction(llvm::Function&);
+
+	private:
+		struct Impl;
+		std::unique_ptr<Impl> impl;
+	};
+}
+
+#endif
@@ -0,0 +1,127 @@
+// implementation of funcextract-c.h on top of funcextract::ModuleAnalyzer.
+#include "funcextract-c.h"
+#include "FuncExtract.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/ValueSymbolTable.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cstdlib>
+#include <cstring>
+
+using namespace llvm;
+
+namespace {
+	struct FXModule {
+		LLVMContext context;
+		std::unique_ptr<Module> M;
+		std::unique_ptr<funcextract::ModuleAnalyzer> analyzer; // must go before the module.
+	};
+
+	static BasicBlock * findBlock(Function *F, const char *name) {
+		return dyn_cast_or_null<BasicBlock>(F->getValueSymbolTable()->lookup(name));
+	}
+
+	static FXRegionRef wrap(funcextract::RegionRecord *R) { return reinterpret_cast<FXRegionRef>(R); }
+	static funcextract::RegionRecord * unwrap(FXRegionRef R) { return reinterpret_cast<funcextract::RegionRecord *>(R); }
+	static FXModule * unwrap(FXModuleRef M) { return reinterpret_cast<FXModule *>(M); }
+}
+
+int fx_parse_options(int argc, const char *const *argv) {
+	// region list and output directory only matter for the passes.
+	StringMap<cl::Option *>& options = cl::getRegisteredOptions();
+	options["bblist"]->setNumOccurrencesFlag(cl::Optional);
+	options["out"]->setNumOccurrencesFlag(cl::Optional);
+
+	// options keep their occurrence counts, so a second call would fail with "may only occur 
+	// zero or one times". Every call starts over from the defaults instead.
+	cl::ResetAllOptionOccurrences();
+
+	std::vector<const char *> args(1, "funcextract");
+	args.insert(args.end(), argv, argv + argc);
+
+	// with an error stream given, bad options are reported instead of exiting the process.
+	return cl::ParseCommandLineOptions(args.size(), args.data(), "", &errs()) ? 0 : 1;
+}
+
+FXModuleRef fx_module_load(const char *path, char **error) {
+	std::unique_ptr<FXModule> module(new FXModule());
+	SMDiagnostic err;
+	module->M = parseIRFile(path, err, module->context);
+	if (!module->M) {
+		if (error) {
+			std::string message;
+			raw_string_ostream out(message);
+			err.print(path, out);
+			*error = strdup(out.str().c_str());
+		}
+		return nullptr;
+	}
+
+	module->analyzer.reset(new funcextract::ModuleAnalyzer(*module->M));
+	return reinterpret_cast<FXModuleRef>(module.release());
+}
+
+void fx_module_dispose(FXModuleRef module) { delete unwrap(module); }
+
+void fx_dispose_message(char *message) { free(message); }
+
+FXRegionRef fx_analyze_region(FXModuleRef module, const char *function, const char *entry, const char *exit) {
+	Function *F = unwrap(module)->M->getFunction(function);
+	if (!F || F->isDeclaration()) { return nullptr; }
+	BasicBlock *entryBB = findBlock(F, entry);
+	BasicBlock *exitBB = exit ? findBlock(F, exit) : nullptr;
+	if (!entryBB || (exit && !exitBB)) { return nullptr; }
+
+	std::unique_ptr<funcextract::RegionRecord> record(new funcextract::RegionRecord());
+	if (!unwrap(module)->analyzer->analyzeRegion(*F, entryBB, exitBB, *record)) { return nullptr; }
+	return wrap(record.release());
+}
+
+FXRegionRef fx_analyze_lines(FXModuleRef module, const char *function, unsigned start, unsigned end) {
+	Function *F = unwrap(module)->M->getFunction(function);
+	if (!F) { return nullptr; }
+
+	std::unique_ptr<funcextract::RegionRecord> record(new funcextract::RegionRecord());
+	if (!unwrap(module)->analyzer->analyzeRegionForLines(*F, start, end, *record)) { return nullptr; }
+	return wrap(record.release());
+}
+
+void fx_region_dispose(FXRegionRef region) { delete unwrap(region); }
+
+const char *fx_region_funcname(FXRegionRef region)   { return unwrap(region)->funcname.c_str(); }
+const char *fx_region_returntype(FXRegionRef region) { return unwrap(region)->returntype.c_str(); }
+unsigned fx_region_start(FXRegionRef region)   { return unwrap(region)->region.first; }
+unsigned fx_region_end(FXRegionRef region)     { return unwrap(region)->region.second; }
+unsigned fx_function_start(FXRegionRef region) { return unwrap(region)->function.first; }
+unsigned fx_function_end(FXRegionRef region)   { return unwrap(region)->function.second; }
+int fx_region_toplevel(FXRegionRef region) { return unwrap(region)->toplevel; }
+int fx_region_liveness(FXRegionRef region) { return unwrap(region)->liveness; }
+int fx_region_readnone(FXRegionRef region)   { return unwrap(region)->readnone; }
+int fx_region_readonly(FXRegionRef region)   { return unwrap(region)->readonly; }
+int fx_region_argmemonly(FXRegionRef region) { return unwrap(region)->argmemonly; }
+
+unsigned fx_region_num_exits(FXRegionRef region) { return unwrap(region)->exits.size(); }
+unsigned fx_region_exit(FXRegionRef region, unsigned index) { return unwrap(region)->exits[index]; }
+
+unsigned fx_region_num_variables(FXRegionRef region) { return unwrap(region)->variables.size(); }
+const char *fx_variable_name(FXRegionRef region, unsigned index) { return unwrap(region)->variables[index].name.c_str(); }
+const char *fx_variable_type(FXRegionRef region, unsigned index) { return unwrap(region)->variables[index].type.c_str(); }
+
+unsigned fx_variable_flags(FXRegionRef region, unsigned index) {
+	const funcextract::VariableInfo& info = unwrap(region)->variables[index];
+	return (info.typehasname ? FX_TYPEHASNAME : 0) | (info.isfunptr ? FX_ISFUNPTR : 0) |
+		   (info.isconstq ? FX_ISCONSTQ : 0) | (info.isstatic ? FX_ISSTATIC : 0) |
+		   (info.isarrayt ? FX_ISARRAYT : 0) | (info.ismodified ? FX_ISMODIFIED : 0) |
+		   (info.islocal ? FX_ISLOCAL : 0) | (info.isoutput ? FX_ISOUTPUT : 0) |
+		   (info.isrestrict ? FX_ISRESTRICT : 0) | (info.isnonnull ? FX_ISNONNULL : 0);
+}
+
+unsigned long long fx_variable_size(FXRegionRef region, unsigned index) { return unwrap(region)->variables[index].size; }
+unsigned fx_variable_align(FXRegionRef region, unsigned index) { return unwrap(region)->variables[index].align; }
+unsigned fx_variable_pointer_align(FXRegionRef region, unsigned index) { return unwrap(region)->variables[index].pointeralign; }
+
+unsigned fx_variable_num_liveexits(FXRegionRef region, unsigned index) { return unwrap(region)->variables[index].liveexits.size(); }
+unsigned fx_variable_liveexit(FXRegionRef region, unsigned index, unsigned exit) { return unwrap(region)->variables[index].liveexits[exit]; }
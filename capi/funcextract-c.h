@@ -0,0 +1,80 @@
+/* C interface to region analysis, meant for calling it in-process (e.g. from Python through
+ * ctypes) instead of going through files written by the pass. Strings returned by the 
+ * library are owned by the object they come from. */
+#ifndef FUNCEXTRACT_C_H
+#define FUNCEXTRACT_C_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct FXOpaqueModule *FXModuleRef;
+typedef struct FXOpaqueRegion *FXRegionRef;
+
+/* variable flags, same bits as used by binary record format. */
+enum {
+	FX_TYPEHASNAME = 1,
+	FX_ISFUNPTR    = 2,
+	FX_ISCONSTQ    = 4,
+	FX_ISSTATIC    = 8,
+	FX_ISARRAYT    = 16,
+	FX_ISMODIFIED  = 32,
+	FX_ISLOCAL     = 64,
+	FX_ISOUTPUT    = 128,
+	FX_ISRESTRICT  = 256,
+	FX_ISNONNULL   = 512
+};
+
+/* sets analysis options using command line syntax, i.e. "-funcextract-engine=summary". 
+ * Can be called any number of times, options not given in a call go back to their defaults.
+ * Returns 0 on success. */
+int fx_parse_options(int argc, const char *const *argv);
+
+/* loads bitcode or textual IR. On failure returns NULL and sets *error, if given, to a
+ * message which has to be freed with fx_dispose_message. */
+FXModuleRef fx_module_load(const char *path, char **error);
+void fx_module_dispose(FXModuleRef module);
+void fx_dispose_message(char *message);
+
+/* analyses region of the function with given entry / exit block names. exit is NULL for 
+ * regions ending with function return. Returns NULL if there is no such region. */
+FXRegionRef fx_analyze_region(FXModuleRef module, const char *function, const char *entry, const char *exit);
+
+/* same as above, for the smallest region covering lines [start, end] of the function. */
+FXRegionRef fx_analyze_lines(FXModuleRef module, const char *function, unsigned start, unsigned end);
+void fx_region_dispose(FXRegionRef region);
+
+const char *fx_region_funcname(FXRegionRef region);
+const char *fx_region_returntype(FXRegionRef region);
+unsigned fx_region_start(FXRegionRef region);
+unsigned fx_region_end(FXRegionRef region);
+unsigned fx_function_start(FXRegionRef region);
+unsigned fx_function_end(FXRegionRef region);
+int fx_region_toplevel(FXRegionRef region);
+int fx_region_liveness(FXRegionRef region);
+/* memory effects of the extracted function, see RegionRecord. */
+int fx_region_readnone(FXRegionRef region);
+int fx_region_readonly(FXRegionRef region);
+int fx_region_argmemonly(FXRegionRef region);
+
+unsigned fx_region_num_exits(FXRegionRef region);
+unsigned fx_region_exit(FXRegionRef region, unsigned index);
+
+unsigned fx_region_num_variables(FXRegionRef region);
+const char *fx_variable_name(FXRegionRef region, unsigned index);
+const char *fx_variable_type(FXRegionRef region, unsigned index);
+unsigned fx_variable_flags(FXRegionRef region, unsigned index);
+/* size and alignment in bytes, 0 if unknown. */
+unsigned long long fx_variable_size(FXRegionRef region, unsigned index);
+unsigned fx_variable_align(FXRegionRef region, unsigned index);
+/* known alignment of what pointer or array points to, 0 unless above alignment of its type. */
+unsigned fx_variable_pointer_align(FXRegionRef region, unsigned index);
+/* exit lines after which the variable is still needed, only with -funcextract-liveness. */
+unsigned fx_variable_num_liveexits(FXRegionRef region, unsigned index);
+unsigned fx_variable_liveexit(FXRegionRef region, unsigned index, unsigned exit);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
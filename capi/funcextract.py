@@ -0,0 +1,122 @@
+# ctypes wrapper around libFuncExtractC. Gives the same variable info extractor.py reads from
+# XML, without going through files:
+#
+#   fx = FuncExtract('build/lib/libFuncExtractC.so')
+#   module = fx.load('mysourcefile.bc')
+#   region = module.analyze_region('main', 'for.cond', 'for.end')
+#   for var in region.variables: print(var.name, var.type, var.isoutput)
+import ctypes
+
+FLAGS = ['typehasname', 'isfunptr', 'isconstq', 'isstatic', 'isarrayt', 'ismodified', 'islocal', 'isoutput',
+         'isrestrict', 'isnonnull']
+
+class Variable:
+    def __init__(self, name, type, flags, size, align, pointeralign, liveexits):
+        self.name = name
+        self.type = type
+        self.size = size   # bytes, 0 if unknown.
+        self.align = align
+        self.pointeralign = pointeralign # alignment of what pointer points to, 0 if nothing more than its type's.
+        self.liveexits = liveexits # exit lines after which the variable is still needed.
+        for bit, flag in enumerate(FLAGS): setattr(self, flag, bool(flags & (1 << bit)))
+
+    def __repr__(self):
+        return '<Variable name:%s type:%s isoutput:%s>' % (self.name, self.type, self.isoutput)
+
+class Region:
+    def __init__(self, lib, handle):
+        self.funcname = lib.fx_region_funcname(handle).decode('utf-8')
+        self.funcreturntype = lib.fx_region_returntype(handle).decode('utf-8')
+        self.region = (lib.fx_region_start(handle), lib.fx_region_end(handle))
+        self.function = (lib.fx_function_start(handle), lib.fx_function_end(handle))
+        self.toplevel = bool(lib.fx_region_toplevel(handle))
+        self.liveness = bool(lib.fx_region_liveness(handle))
+        self.readnone = bool(lib.fx_region_readnone(handle))
+        self.readonly = bool(lib.fx_region_readonly(handle))
+        self.argmemonly = bool(lib.fx_region_argmemonly(handle))
+        self.exits = [lib.fx_region_exit(handle, i) for i in range(lib.fx_region_num_exits(handle))]
+        self.variables = [Variable(lib.fx_variable_name(handle, i).decode('utf-8'), 
+                                   lib.fx_variable_type(handle, i).decode('utf-8'),
+                                   lib.fx_variable_flags(handle, i),
+                                   lib.fx_variable_size(handle, i),
+                                   lib.fx_variable_align(handle, i),
+                                   lib.fx_variable_pointer_align(handle, i),
+                                   [lib.fx_variable_liveexit(handle, i, j) for j in range(lib.fx_variable_num_liveexits(handle, i))]) 
+                          for i in range(lib.fx_region_num_variables(handle))]
+
+class Module:
+    def __init__(self, lib, handle):
+        self.lib = lib
+        self.handle = handle
+
+    def __del__(self):
+        if self.handle: self.lib.fx_module_dispose(self.handle)
+
+    # returns None if there is no such region. exit is None for regions ending with function return.
+    def analyze_region(self, function, entry, exit):
+        exit = exit.encode('utf-8') if exit != None else None
+        return self._record(self.lib.fx_analyze_region(self.handle, function.encode('utf-8'), entry.encode('utf-8'), exit))
+
+    def analyze_lines(self, function, start, end):
+        return self._record(self.lib.fx_analyze_lines(self.handle, function.encode('utf-8'), start, end))
+
+    def _record(self, handle):
+        if not handle: return None
+        region = Region(self.lib, handle)
+        self.lib.fx_region_dispose(handle)
+        return region
+
+class FuncExtract:
+    def __init__(self, path):
+        lib = ctypes.CDLL(path)
+        ptr = ctypes.c_void_p
+        for name, restype, argtypes in [
+                ('fx_parse_options',        ctypes.c_int,    [ctypes.c_int, ctypes.POINTER(ctypes.c_char_p)]),
+                ('fx_module_load',          ptr,             [ctypes.c_char_p, ctypes.POINTER(ptr)]),
+                ('fx_module_dispose',       None,            [ptr]),
+                ('fx_dispose_message',      None,            [ptr]),
+                ('fx_analyze_region',       ptr,             [ptr, ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p]),
+                ('fx_analyze_lines',        ptr,             [ptr, ctypes.c_char_p, ctypes.c_uint, ctypes.c_uint]),
+                ('fx_region_dispose',       None,            [ptr]),
+                ('fx_region_funcname',      ctypes.c_char_p, [ptr]),
+                ('fx_region_returntype',    ctypes.c_char_p, [ptr]),
+                ('fx_region_start',         ctypes.c_uint,   [ptr]),
+                ('fx_region_end',           ctypes.c_uint,   [ptr]),
+                ('fx_function_start',       ctypes.c_uint,   [ptr]),
+                ('fx_function_end',         ctypes.c_uint,   [ptr]),
+                ('fx_region_toplevel',      ctypes.c_int,    [ptr]),
+                ('fx_region_liveness',      ctypes.c_int,    [ptr]),
+                ('fx_region_readnone',      ctypes.c_int,    [ptr]),
+                ('fx_region_readonly',      ctypes.c_int,    [ptr]),
+                ('fx_region_argmemonly',    ctypes.c_int,    [ptr]),
+                ('fx_region_num_exits',     ctypes.c_uint,   [ptr]),
+                ('fx_region_exit',          ctypes.c_uint,   [ptr, ctypes.c_uint]),
+                ('fx_region_num_variables', ctypes.c_uint,   [ptr]),
+                ('fx_variable_name',        ctypes.c_char_p, [ptr, ctypes.c_uint]),
+                ('fx_variable_type',        ctypes.c_char_p, [ptr, ctypes.c_uint]),
+                ('fx_variable_flags',       ctypes.c_uint,   [ptr, ctypes.c_uint]),
+                ('fx_variable_size',        ctypes.c_ulonglong, [ptr, ctypes.c_uint]),
+                ('fx_variable_align',       ctypes.c_uint,   [ptr, ctypes.c_uint]),
+                ('fx_variable_pointer_align', ctypes.c_uint, [ptr, ctypes.c_uint]),
+                ('fx_variable_num_liveexits', ctypes.c_uint, [ptr, ctypes.c_uint]),
+                ('fx_variable_liveexit',    ctypes.c_uint,   [ptr, ctypes.c_uint, ctypes.c_uint]) ]:
+            fn = getattr(lib, name)
+            fn.restype = restype
+            fn.argtypes = argtypes
+        self.lib = lib
+
+    # options in command line syntax, i.e. ['-funcextract-engine=summary', '-funcextract-liveness'].
+    # Replaces options of earlier calls, the rest are reset to defaults.
+    def set_options(self, options):
+        argv = (ctypes.c_char_p * len(options))(*[o.encode('utf-8') for o in options])
+        if self.lib.fx_parse_options(len(options), argv) != 0:
+            raise Exception('Invalid options: %s' % ' '.join(options))
+
+    def load(self, path):
+        error = ctypes.c_void_p()
+        handle = self.lib.fx_module_load(path.encode('utf-8'), ctypes.byref(error))
+        if not handle:
+            message = ctypes.cast(error, ctypes.c_char_p).value.decode('utf-8')
+            self.lib.fx_dispose_message(error)
+            raise Exception(message)
+        return Module(self.lib, handle)
@@ -1,6 +1,7 @@
 import sys
 import re
 import argparse
+import json
 import xml.etree.cElementTree as ET
 
 # global command line arguments
@@ -20,6 +21,9 @@ class FileInfo:
         self.funrettype = ""  # return type of the function
         self.funname = ""     # name of the extracted function
         self.toplevel = False # is the region a function already?
+        self.liveness = False # does xml tell us which variables have to be written back?
+        self.readnone = False # memory effects of extracted function, see Function.get_attributes.
+        self.readonly = False
 
     # in case if region starts with the same line as the function we are extracting from, 
     # it means that function header is also a part of a region and has to be separated from 
@@ -103,11 +107,15 @@ class FileInfo:
     def extract(self):
         sys.stdout.write('#include <string.h>\n')
         function = Function(self.funname, self.funrettype)
+        function.readnone = self.readnone
+        function.readonly = self.readonly
         for var in self.vars:
             function.add_variable(var)
+        function.plan_arguments(self.regloc)
 
         for loc in sorted(self.exitlocs):
             function.check_exit_loc(self.regloc, loc)
+        function.rewrite_exits(self.regloc, self.toplevel)
 
         # prepend stuff if flag is set
         for loc in self.prefunc:  
@@ -167,6 +175,10 @@ class LocInfo:
 
 #######################################
 class Variable: 
+    # ways of passing an input into extracted function, see Function.plan_arguments.
+    BY_VALUE   = 0
+    BY_POINTER = 1 # region works on caller's variable, nothing has to be written back.
+
     def __init__(self, name, type):
         self.name = name
         self.type = type
@@ -176,6 +188,15 @@ class Variable:
         self.isstatic = False
         self.isconstq = False
         self.isarrayt = False
+        self.ismodified = True # has to be written back after the region.
+        self.islocal = False   # value on region entry is never used, no need to pass it in.
+        self.size = 0          # bytes, 0 if unknown.
+        self.align = 0
+        self.isrestrict = False # nothing else passed in reaches what the variable points to / its storage.
+        self.isnonnull = False
+        self.pointeralign = 0   # known alignment of what pointer points to, 0 if nothing more than its type's.
+        self.passing = Variable.BY_VALUE
+        self.liveexits = None  # exit lines after which the value is needed, None if needed after all of them.
 
     def __repr__(self):
         return '<Variable name:%s type:%s isoutput:%s>' % (self.name, self.type, self.isoutput)
@@ -184,20 +205,63 @@ class Variable:
         if self.typehasname: return self.type
         return ('%s %s') % (self.type, self.name)
 
+    # name of the parameter the caller's variable is accessed through. 
+    def pointer_name(self):
+        return '%s_ptr' % self.name
+
+    # pointer types as printed by the pass, possibly qualified. Typedefs of pointers are not recognized.
+    def is_pointer(self):
+        if self.typehasname or self.isfunptr: return False
+        tokens = list(filter(lambda x: x not in ['', 'const', 'volatile'], self.type.split(' ')))
+        return len(tokens) != 0 and tokens[-1] == '*'
+
+    # const qualified variables end up behind a const pointer, as the type keeps the qualifier.
+    # Array parameters take restrict inside their outermost brackets.
+    def as_parameter(self):
+        restrict = 'restrict ' if self.isrestrict else ''
+        if self.passing == Variable.BY_POINTER: return '%s *%s%s' % (self.type.rstrip(' '), restrict, self.pointer_name())
+        if self.isrestrict and self.isarrayt: return self.type.replace('[', '[restrict ', 1)
+        if self.isrestrict and self.is_pointer(): return '%s restrict %s' % (self.type, self.name)
+        return self.as_function_argument()
+
+    # parameter the compiler may assume to be non-null. Caller's variables always are.
+    def is_nonnull_parameter(self):
+        if self.passing == Variable.BY_POINTER: return True
+        return self.isnonnull and (self.isarrayt or self.is_pointer())
+
+    # tells the compiler about alignment of what pointer parameter points to. Const pointers can not 
+    # be assigned, decayed arrays can.
+    def assume_aligned(self):
+        if self.passing == Variable.BY_POINTER or self.pointeralign == 0: return ''
+        if not self.isarrayt and (self.isconstq or not self.is_pointer()): return ''
+        return '\t%s = __builtin_assume_aligned(%s, %d);\n' % (self.name, self.name, self.pointeralign)
+
+    def as_call_argument(self):
+        if self.passing == Variable.BY_POINTER: return '&%s' % self.name
+        return self.name
+
+    def unqualified_type(self):
+        return ' '.join(filter(lambda x: x != 'const', self.type.split(' '))).strip(' ')
+
     # have to get rid of const qualifiers
     # Should not allow input constants to be in the struct.
     def as_struct_member(self):
+        if not self.ismodified: return ''
+        if self.passing == Variable.BY_POINTER: return ''
         if not self.isoutput and self.isconstq: return ''
         if not self.isoutput and self.isarrayt: return ''
         ntype = list(filter(lambda x: x != 'const', self.as_function_argument().split(' ')))
         ntype = ' '.join(ntype).rstrip(' ')
         return '\t%s;\n' % ntype
 
-    # Declares a variable and initializes it from struct. Static variables have to be initialized to some constant first. FIXME 
-    def declare_and_initialize(self, struct):
+    # Declares a variable and initializes it from field of returned struct, or the returned value itself.
+    # Static variables have to be initialized to some constant first. FIXME 
+    def declare_and_initialize(self, field):
         assert(self.isoutput)
         declr = self.as_function_argument()
-        field = '%s.%s' % (struct, self.name)
+
+        # value is dead after the region, caller only needs the declaration.
+        if not self.ismodified: return self.declare()
         
         # arrays we have to memcpy. 
         restore = '' 
@@ -209,19 +273,35 @@ class Variable:
         if self.isstatic: return 'static %s;\n %s %s;\n' % (declr, self.name, restore)
         return '%s %s;\n' % (declr, restore)
 
+    def declare(self):
+        if self.isstatic: return 'static %s;\n' % self.as_function_argument()
+        return '%s;\n' % self.as_function_argument()
+
     # const qualified inputs / array inputs should not be restored. Consts for obvious reasons and array
-    # decays to pointer type.
-    def restore(self, struct):
+    # decays to pointer type. Outputs are only restored this way if declared beforehand.
+    def restore(self, field):
+        if not self.ismodified: return ''
+        if self.passing == Variable.BY_POINTER: return ''
         if self.isconstq: return '' 
+        if self.isoutput and self.isarrayt: return 'memcpy(%s, %s, sizeof(%s));\n' % (self.name, field, field)
         if self.isarrayt: return ''
-        return '%s = %s.%s;\n' % (self.name, struct, self.name)
-
-    def store(self, struct):
+        return '%s = %s;\n' % (self.name, field)
+
+    # with liveness info, variables are only handed back at exits after which they are needed. Const
+    # outputs are initialized by the caller right after the call, whatever exit has been taken.
+    def is_live_at(self, locs):
+        if self.liveexits == None: return True
+        if self.isoutput and self.isconstq: return True
+        return any(loc in self.liveexits for loc in locs)
+
+    def store(self, field):
+        if not self.ismodified: return ''
+        if self.passing == Variable.BY_POINTER: return ''
         if not self.isoutput and self.isconstq: return ''
         if not self.isoutput and self.isarrayt: return ''
         if self.isarrayt:
-            return 'memcpy(%s.%s, %s, sizeof(%s));\n' % (struct, self.name, self.name, self.name)
-        return '%s.%s = %s;\n' % (struct, self.name, self.name)
+            return 'memcpy(%s, %s, sizeof(%s));\n' % (field, self.name, self.name)
+        return '%s = %s;\n' % (field, self.name)
 
     # read xml into variable type.
     @staticmethod
@@ -234,6 +314,13 @@ class Variable:
         isstatic = xml.find('isstatic')
         isconstq = xml.find('isconstq')
         isarrayt = xml.find('isarrayt')
+        ismodified = xml.find('ismodified')
+        islocal = xml.find('islocal')
+        size = xml.find('size')
+        align = xml.find('align')
+        isrestrict = xml.find('isrestrict')
+        isnonnull = xml.find('isnonnull')
+        pointeralign = xml.find('pointeralign')
         
         #name, ptrl and type are required
         if name == None or type == None:
@@ -246,126 +333,193 @@ class Variable:
         if isstatic != None: variable.isstatic = bool(isstatic.text)
         if isconstq != None: variable.isconstq = bool(isconstq.text)
         if isarrayt != None: variable.isarrayt = bool(isarrayt.text)
+        variable.ismodified = ismodified != None and bool(ismodified.text)
+        if islocal != None: variable.islocal = bool(islocal.text)
+        if size != None: variable.size = int(size.text)
+        if align != None: variable.align = int(align.text)
+        if isrestrict != None: variable.isrestrict = bool(isrestrict.text)
+        if isnonnull != None: variable.isnonnull = bool(isnonnull.text)
+        if pointeralign != None: variable.pointeralign = int(pointeralign.text)
+        variable.liveexits = [int(loc.text) for loc in xml.findall('liveexit')]
         return variable
 
-# if condition class for possible return / goto statements inside the region that we have to check 
-# in the caller function
+    # same as above, but for dict of fields read from json / binary record.
+    @staticmethod
+    def from_fields(fields):
+        if 'name' not in fields or 'type' not in fields:
+            raise Exception('Missing variable info');
+
+        variable = Variable(fields['name'], fields['type'].strip())
+        for flag in ['typehasname', 'isoutput', 'isfunptr', 'isstatic', 'isconstq', 'isarrayt', 'islocal', 'isrestrict', 'isnonnull']:
+            setattr(variable, flag, bool(fields.get(flag, False)))
+        variable.ismodified = bool(fields.get('ismodified', False))
+        variable.size = int(fields.get('size', 0))
+        variable.align = int(fields.get('align', 0))
+        variable.pointeralign = int(fields.get('pointeralign', 0))
+        variable.liveexits = list(fields.get('liveexits', []))
+        return variable
+
+# return / goto statement inside the region. Extracted function hands back the code of the exit taken
+# (0 when the region is left without one), the caller checks it and returns / jumps accordingly.
+# Values of return statements share a single member of the return struct.
 class RegionExit:
     STMT_GOTO    = 0
     STMT_RET     = 1
     STMT_RETVOID = 2
 
-    def __init__(self, flg, val, storevar, stmt):
-        self.flgvar = flg #flag variable. If we return/goto we set this flag to 1 
-        self.valvar = val #if we return some value, we store that value in this variable
-        self.storevar = storevar  #variable to store in variable above
+    def __init__(self, code, stmt, loc, target):
+        self.code = code     # exit code, 1 and up.
         self.stmt = stmt
-        self.flgvar.isoutput = True
+        self.loc = loc       # line of the statement.
+        self.target = target # label we go to / expression we return, None for void returns.
 
-    # we don't need to add return value if we either return void or we go to some label.
-    def as_struct_member(self):
-        if self.stmt == RegionExit.STMT_GOTO:    return self.flgvar.as_struct_member()
-        if self.stmt == RegionExit.STMT_RETVOID: return self.flgvar.as_struct_member()
-        return self.flgvar.as_struct_member() + self.valvar.as_struct_member()
-
-    # returns the if statement that checks if condition flag is set and then adds return / goto 
-    # statements accordingly.
-    def make_conditional_stmt(self, struct):
-        val = ''
-        if self.stmt == RegionExit.STMT_GOTO:    val = 'goto %s;' % self.storevar.name
-        if self.stmt == RegionExit.STMT_RET :    val = 'return %s.%s;' % (struct, self.valvar.name)
-        if self.stmt == RegionExit.STMT_RETVOID: val = 'return;'
-        return 'if (%s.%s) { %s }\n' % (struct, self.flgvar.name, val)
-
-    # declares flags inside the region and sets them to 0
-    def initialize(self, struct):
-        return '%s.%s = 0;\n' % (struct, self.flgvar.name) 
-
-    # store flag and retval into return struct.
-    def store(self, struct):
-        val = ''
-        if self.stmt == RegionExit.STMT_RET: val = '%s.%s = %s;\n' % (struct, self.valvar.name, self.storevar.name) 
-        return '%s.%s = 1;\n%s' % (struct, self.flgvar.name, val)
+    # statement the caller executes once the exit has been taken.
+    def caller_stmt(self, value):
+        if self.stmt == RegionExit.STMT_GOTO: return 'goto %s;' % self.target
+        if self.stmt == RegionExit.STMT_RET:  return 'return %s;' % value
+        return 'return;'
 
 class Function:
     def __init__(self, funname, funrettype):
         self.inputs  = []
         self.outputs = []
-        self.special = [] # for return / gotos within region. (see below)
+        self.special = []     # for return / gotos within region. (see below)
+        self.normalexits = [] # lines where region is left without return / goto.
 
         self.funname    = funname     # name of the extracted function
         self.funrettype = funrettype  # return type of the original function
+        self.readnone = False         # region touches no memory but its own variables.
+        self.readonly = False         # region writes no memory but its own variables.
         self.retvalname = '%s_retval' # name of the structure returned from the extracted function 
         self.retvaltype = 'struct %s_struct' # type name of the structure returned from extracted function
 
         # if extracted function contains return / goto statements, we need to also return same values
-        # from caller function. The idea is to use (flag, value) pairs. After extracted function returns, 
-        # we check these flags in the caller and return accordingly.
-        self.exitflagname  = '%s_flag_loc%s' 
-        self.exitvaluename = '%s_value_loc%s'
+        # from caller function. The idea is to return code of the exit taken along with the returned value,
+        # after extracted function returns we check the code in the caller and return accordingly.
+        self.exitcode  = Variable('%s_exit' % funname, 'int')
+        self.exitvalue = Variable('%s_value' % funname, funrettype)
+        self.exitcode.isoutput = True
+        self.exitvalue.isoutput = True
+        self.exitcode.size = 4
+        self.exitcode.align = 4
 
     ## add variable to either input / output list.
     def add_variable(self, var):
         if var.isoutput: self.outputs.append(var)
         else: self.inputs.append(var)
 
+    # Decides how inputs are passed. Inputs up to --byvalue-limit bytes are copied in and, if modified, 
+    # copied back through the return struct. Larger ones are passed by pointer, so the region works on 
+    # caller's variable and nothing is copied either way; their uses in the region go through the pointer.
+    # Arrays already decay to pointers, inputs of unknown size stay by value.
+    def plan_arguments(self, regloc):
+        for var in self.inputs:
+            if var.islocal or var.isarrayt or var.typehasname: continue
+            if var.size <= CLI_ARGS.byvalue_limit: continue
+            var.passing = Variable.BY_POINTER
+            for num in regloc: regloc[num] = replace_identifier(regloc[num], var.name, '(*%s)' % var.pointer_name())
+
+    # values handed back by extracted function, in the order of the return struct. Members go by 
+    # decreasing alignment so there is no padding between them, unknown alignment last.
+    def get_members(self):
+        members = list(filter(lambda var: var.as_struct_member() != '', self.inputs + self.outputs))
+        if len(self.special) != 0: members.append(self.exitcode)
+        if any(exit.stmt == RegionExit.STMT_RET for exit in self.special): members.append(self.exitvalue)
+        return sorted(members, key=lambda var: -var.align)
+
+    # value returned as is instead of a struct, if it is the only one to hand back. That may also be 
+    # the exit code. Arrays and function pointers can not be returned that way.
+    def get_direct_return(self, toplevel):
+        if toplevel: return None
+        members = self.get_members()
+        if len(members) != 1 or members[0].isarrayt or members[0].typehasname: return None
+        return members[0]
+
+    # where the value of the variable is in what extracted function returns.
+    def get_return_field(self, var, toplevel):
+        if var is self.get_direct_return(toplevel): return self.get_self_retval_name()
+        return '%s.%s' % (self.get_self_retval_name(), var.name)
+
     # get extracted function's return type.
     def get_self_return_type(self, toplevel):
         if toplevel: return self.funrettype
+        direct = self.get_direct_return(toplevel)
+        if direct != None: return direct.unqualified_type()
         return self.retvaltype % (self.funname)
 
     def get_self_retval_name(self):
         return self.retvalname % (self.funname)
 
-    # replace return / goto statement in the region with setting flag to 1 and setting value to whatever
-    # comes on the rhs of the return statement.
+    # collects return / goto statements of the region, they are replaced once all of them are known.
     # we expect return/goto statements formatted in a certain way.
     def check_exit_loc(self, regloc, loc):
         temp = regloc[loc]
         temp = temp.lstrip('\t ')
         temp = temp.rstrip('\n; ')
-        rett = self.get_self_retval_name()
-
+        code = len(self.special) + 1
 
         retstmt = line_contains(temp, 'return')
         if retstmt != (None, None):
-            storeinto, storetarget, stmttype = None, None, RegionExit.STMT_RETVOID
-            flg = Variable(self.exitflagname  % (self.funname, loc), 'char')
-            if retstmt[1] != None: 
-                storetarget = Variable(retstmt[1], self.funrettype) 
-                storeinto   = Variable(self.exitvaluename % (self.funname, loc), self.funrettype) 
-                stmttype = RegionExit.STMT_RET
-
-            exit = RegionExit(flg, storeinto, storetarget, stmttype)
-            self.special.append(exit) 
-            regloc[loc] = '%sreturn %s;\n' % (exit.store(rett), rett)    
+            if retstmt[1] != None: self.special.append(RegionExit(code, RegionExit.STMT_RET, loc, retstmt[1]))
+            else: self.special.append(RegionExit(code, RegionExit.STMT_RETVOID, loc, None))
             return
 
-        ## TODO 
         gotostmt = line_contains(temp, 'goto')
         if gotostmt != (None, None):
-            storeinto, storetarget, stmttype = None, None, RegionExit.STMT_RETVOID
-            flg = Variable(self.exitflagname  % (self.funname, loc), 'char')
-            storeinto   = Variable(self.exitvaluename % (self.funname, loc), self.funrettype) 
-            storetarget = Variable(gotostmt[1], self.funrettype) 
-            stmttype = RegionExit.STMT_GOTO 
-            exit = RegionExit(flg, storeinto, storetarget, stmttype)
-            self.special.append(exit) 
-            regloc[loc] = '%s%s' % (exit.store(rett), self.store_retvals_and_return(False))    
+            self.special.append(RegionExit(code, RegionExit.STMT_GOTO, loc, gotostmt[1]))
+            return
+        self.normalexits.append(loc)
+
+    # replaces return / goto statements with handing back the exit code, returned value and variables
+    # needed after the exit. After return statements the caller returns right away, only statics outlive
+    # it. They are stored after the returned value, which may modify them.
+    def rewrite_exits(self, regloc, toplevel):
+        code = self.get_return_field(self.exitcode, toplevel)
+        for exit in self.special:
+            out = ''
+            if exit.stmt == RegionExit.STMT_GOTO: out = self.store_variables([exit.loc], toplevel)
+            if exit.stmt == RegionExit.STMT_RET: out = '%s = %s;\n' % (self.get_return_field(self.exitvalue, toplevel), exit.target)
+            if exit.stmt != RegionExit.STMT_GOTO: out = out + self.store_statics(toplevel)
+            if self.get_direct_return(toplevel) is self.exitcode: regloc[exit.loc] = '%sreturn %d;\n' % (out, exit.code)
+            else: regloc[exit.loc] = '%s%s = %d;\nreturn %s;\n' % (out, code, exit.code, self.get_self_retval_name())
+
+    # attributes of the definition. Purity facts of the pass hold for inputs copied into parameters, 
+    # those passed by pointer are caller's memory. Functions returning nothing gain nothing from them.
+    def get_attributes(self, toplevel, nonnull):
+        attrs = []
+        copied = all(var.passing == Variable.BY_VALUE for var in self.inputs)
+        if copied and self.get_self_return_type(toplevel) != 'void':
+            if self.readnone: attrs.append('const')
+            elif self.readonly: attrs.append('pure')
+        if len(nonnull) != 0: attrs.append('nonnull(%s)' % ', '.join(nonnull))
+        if len(attrs) == 0: return ''
+        return '__attribute__((%s)) ' % ', '.join(attrs)
 
     ## returns function definition.
+    ## inputs whose value is never read are declared inside the function instead of being passed.
+    ## non-null parameters are listed in nonnull attribute, alignment hints come first in the body.
     def get_fn_definition(self, toplevel):
         args = '' 
-        for var in self.inputs: args = args + var.as_function_argument() + ', '
+        locs = ''
+        nonnull = []
+        params = list(filter(lambda var: not var.islocal, self.inputs))
+        for var in self.inputs: 
+            if var.islocal: locs = locs + '\t%s;\n' % var.as_function_argument()
+        for i, var in enumerate(params):
+            args = args + var.as_parameter() + ', '
+            if var.is_nonnull_parameter(): nonnull.append(str(i + 1))
+            locs = locs + var.assume_aligned()
         args = args.rstrip(', ') 
-        return ('%s %s(%s) {\n') % (self.get_self_return_type(toplevel), self.funname, args)
+        attrs = self.get_attributes(toplevel, nonnull)
+        return ('%s%s %s(%s) {\n%s') % (attrs, self.get_self_return_type(toplevel), self.funname, args, locs)
 
     # returns correct function call string
     # if the region is toplevel, we do not need to return a structure from the extracted function, 
     # and just returning same type as original function would be sufficient.
     def get_fn_call(self, toplevel):
         args = ''
-        for var in self.inputs: args = args + var.name + ', '
+        for var in self.inputs: 
+            if not var.islocal: args = args + var.as_call_argument() + ', '
         args = args.rstrip(', ') 
 
         rett = self.get_self_return_type(toplevel)
@@ -379,24 +533,24 @@ class Function:
     # Const qualified inputs should not be stored in return structure.
     def declare_return_type(self, toplevel):
         if toplevel: return ''
+        if self.get_direct_return(toplevel) != None: return ''
 
         args = '' 
-        for var in self.inputs:  args = args + var.as_struct_member() 
-        for var in self.outputs: args = args + var.as_struct_member()
-        for var in self.special: args = args + var.as_struct_member()
+        for var in self.get_members(): args = args + var.as_struct_member()
         type = self.retvaltype % (self.funname)
         return '%s {\n%s};\n\n' % (type, args)
 
     # Defines return value in the beginning of the extracted function and sets 
-    # special return flags to 0 if those exist
+    # exit code to 0 if there are return / goto exits
     # If region is toplevel, we do not need this.
     def define_return_value(self, toplevel):
         if toplevel: return ''
+        if self.get_direct_return(toplevel) != None: return ''
 
         name = self.retvalname % (self.funname)
         type = self.retvaltype % (self.funname)
         out  = '\t%s %s;\n' % (type, name)
-        for var in self.special: out = out + var.initialize(self.get_self_retval_name())
+        if len(self.special) != 0: out = out + '%s = 0;\n' % self.get_return_field(self.exitcode, toplevel)
         return out 
 
 
@@ -406,26 +560,66 @@ class Function:
     # const-qualified inputs should not be stored!
     def store_retvals_and_return(self, toplevel):
         if toplevel: return ''
+        direct = self.get_direct_return(toplevel)
+        if direct is self.exitcode: return 'return 0;\n'
+        if direct != None: return 'return %s;\n' % direct.name
+        return '%sreturn %s;\n' % (self.store_variables(self.normalexits, toplevel), self.get_self_retval_name())
 
+    # stores variables needed after any of the exits at given lines.
+    def store_variables(self, locs, toplevel):
         args = ''
-        retn = self.get_self_retval_name()
-        for var in self.inputs:  args = args + var.store(retn)
-        for var in self.outputs: args = args + var.store(retn)
-        return '%sreturn %s;\n' % (args, retn)
+        for var in self.inputs + self.outputs:
+            if var.is_live_at(locs): args = args + var.store(self.get_return_field(var, toplevel))
+        return args
+
+    # stores static inputs, the only variables still needed once the caller has returned.
+    def store_statics(self, toplevel):
+        args = ''
+        for var in self.inputs:
+            if var.isstatic: args = args + var.store(self.get_return_field(var, toplevel))
+        return args
 
     # Restores local variables in the caller from the structure returned by
     # extracted function, definining it if necessary. 
     # If region is toplevel, we do not do this!
     # const-qualified inputs should not be restored!
+    # With return / goto exits the exit code is checked first, and each exit only restores variables 
+    # needed after it. Outputs are declared before that, so gotos do not jump over their declarations.
     def restore_retvals(self, toplevel):
         if toplevel: return ''
 
         args = ''
-        retn = self.get_self_retval_name()
-        for var in self.inputs:  args = args + var.restore(retn)
-        for var in self.outputs: args = args + var.declare_and_initialize(retn)
-        for var in self.special: args = args + var.make_conditional_stmt(retn)
-        return args 
+        if len(self.special) == 0:
+            for var in self.inputs:  args = args + var.restore(self.get_return_field(var, toplevel))
+            for var in self.outputs: args = args + var.declare_and_initialize(self.get_return_field(var, toplevel))
+            return args
+
+        # const outputs can only be initialized, they are handed back at every exit.
+        for var in self.outputs:
+            if var.isconstq: args = args + var.declare_and_initialize(self.get_return_field(var, toplevel))
+            else: args = args + var.declare()
+        code = self.get_return_field(self.exitcode, toplevel)
+        value = self.get_return_field(self.exitvalue, toplevel)
+        for exit in self.special:
+            restore = ''
+            if exit.stmt == RegionExit.STMT_GOTO: restore = self.restore_variables([exit.loc], toplevel)
+            else: restore = self.restore_statics(toplevel)
+            args = args + 'if (%s == %d) { %s%s }\n' % (code, exit.code, restore, exit.caller_stmt(value))
+        return args + self.restore_variables(self.normalexits, toplevel)
+
+    # restores variables needed after any of the exits at given lines.
+    def restore_variables(self, locs, toplevel):
+        args = ''
+        for var in self.inputs + self.outputs:
+            if var.is_live_at(locs): args = args + var.restore(self.get_return_field(var, toplevel))
+        return args
+
+    # restores static inputs modified before a return statement.
+    def restore_statics(self, toplevel):
+        args = ''
+        for var in self.inputs:
+            if var.isstatic: args = args + var.restore(self.get_return_field(var, toplevel))
+        return args
         
 # returns the string if it exists in the string. Also returns everything on the right-hand side of such 
 # string. Useful for goto/return statements. Performs certain assertion checks to ensure the code extracted
@@ -448,6 +642,13 @@ def line_contains(line, string):
         return (string, rhs) 
     return (None, None)
 
+# replaces uses of a variable in the line, leaving string / char literals, comments, member names and
+# struct / union / enum tags that happen to be spelled the same alone.
+def replace_identifier(line, name, replacement):
+    keep = r'"(?:\\.|[^"\\])*"|\'(?:\\.|[^\'\\])*\'|//.*|/\*.*?\*/|(?:\.|->)\s*\w+|\b(?:struct|union|enum)\s+\w+'
+    pattern = r'(%s)|\b%s\b' % (keep, re.escape(name))
+    return re.sub(pattern, lambda match: match.group(1) or replacement, line)
+
 # counts number of opening / closing braces. Expects loc to be a dictionary of strings.
 def brace_count(loc):
     numopeningbraces = 0
@@ -465,10 +666,9 @@ def strip_char_string_literals(line):
     return ret
 
 #Boring parsing stuff
-# Read XML file.
-def parse_xml(fileinfo):
-    tree = ET.parse(CLI_ARGS.xml);
-    for child in tree.getroot():
+# Read XML record.
+def parse_xml(fileinfo, data):
+    for child in ET.fromstring(data):
         if (child.tag == 'funcname'):   fileinfo.funname = child.text
         if (child.tag == 'funcreturntype'): fileinfo.funrettype = child.text
         if (child.tag == 'regionexit'): fileinfo.exitlocs.append(int(child.text))
@@ -476,6 +676,135 @@ def parse_xml(fileinfo):
         if (child.tag == 'function'):   fileinfo.funinfo = LocInfo.create(child)
         if (child.tag == 'variable'):   fileinfo.vars.append(Variable.create(child))
         if (child.tag == 'toplevel'):   fileinfo.toplevel = bool(int(child.text))
+        if (child.tag == 'liveness'):   fileinfo.liveness = bool(int(child.text))
+        if (child.tag == 'readnone'):   fileinfo.readnone = bool(int(child.text))
+        if (child.tag == 'readonly'):   fileinfo.readonly = bool(int(child.text))
+
+# Read region record written with --funcextract-format=jsonl.
+def parse_json(fileinfo, data):
+    record = json.loads(data.decode('utf-8'))
+    fileinfo.funname = record['funcname']
+    fileinfo.funrettype = record['funcreturntype']
+    fileinfo.exitlocs = list(record['regionexit'])
+    fileinfo.reginfo = LocInfo(record['region']['start'], record['region']['end'])
+    fileinfo.funinfo = LocInfo(record['function']['start'], record['function']['end'])
+    fileinfo.vars = [Variable.from_fields(v) for v in record['variables']]
+    fileinfo.toplevel = record['toplevel']
+    fileinfo.liveness = record.get('liveness', False)
+    fileinfo.readnone = record.get('readnone', False)
+    fileinfo.readonly = record.get('readonly', False)
+
+class BinaryReader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def bytes(self, length):
+        out = self.data[self.pos:self.pos + length]
+        self.pos = self.pos + length
+        return out
+
+    def uleb128(self):
+        value = 0
+        shift = 0
+        while True:
+            byte = self.data[self.pos]
+            self.pos = self.pos + 1
+            value = value | ((byte & 0x7f) << shift)
+            shift = shift + 7
+            if byte < 0x80: return value
+
+# Read region record written with --funcextract-format=binary.
+# See BinaryRecordWriter in FuncExtract.cpp for the layout.
+BINARY_FLAGS = ['typehasname', 'isfunptr', 'isconstq', 'isstatic', 'isarrayt', 'ismodified', 'islocal', 'isoutput', 
+                'isrestrict', 'isnonnull']
+def parse_binary(fileinfo, data):
+    reader = BinaryReader(bytearray(data))
+    if reader.bytes(4) != b'FXR4':
+        raise Exception('Not a region record.')
+
+    strings = [reader.bytes(reader.uleb128()).decode('utf-8') for i in range(reader.uleb128())]
+    fileinfo.funname = strings[reader.uleb128()]
+    fileinfo.funrettype = strings[reader.uleb128()]
+    fileinfo.reginfo = LocInfo(reader.uleb128(), reader.uleb128())
+    fileinfo.funinfo = LocInfo(reader.uleb128(), reader.uleb128())
+    flags = reader.uleb128()
+    fileinfo.toplevel = bool(flags & 1)
+    fileinfo.liveness = bool(flags & 2)
+    fileinfo.readnone = bool(flags & 4)
+    fileinfo.readonly = bool(flags & 8)
+    fileinfo.exitlocs = [reader.uleb128() for i in range(reader.uleb128())]
+    for i in range(reader.uleb128()):
+        var = {'name': strings[reader.uleb128()], 'type': strings[reader.uleb128()]}
+        flags = reader.uleb128()
+        for bit, flag in enumerate(BINARY_FLAGS): var[flag] = bool(flags & (1 << bit))
+        var['size'] = reader.uleb128()
+        var['align'] = reader.uleb128()
+        var['pointeralign'] = reader.uleb128()
+        var['liveexits'] = [reader.uleb128() for j in range(reader.uleb128())]
+        fileinfo.vars.append(Variable.from_fields(var))
+
+# Splits pass output into single records. Output is either a single record or a number of records
+# written with --funcextract-aggregate: JSON records are one per line, XML / binary ones are 
+# prefixed with their size and a newline.
+# Splits aggregated output into (order, record) pairs. Order is the (function, region) position
+# the pass writes before every record of a sharded run, None otherwise.
+def split_ordered_records(data):
+    if data.startswith(b'<') or data.startswith(b'FXR4'):
+        return [(None, data)]
+
+    records = []
+    order = None
+    pos = 0
+    while pos < len(data):
+        newline = data.find(b'\n', pos)
+        if newline == -1: newline = len(data)
+        line = data[pos:newline]
+        if line.startswith(b'#order '):
+            order = tuple(int(n) for n in line.split()[1:3])
+            pos = newline + 1
+        elif line.startswith(b'{'):
+            records.append((order, line))
+            order = None
+            pos = newline + 1
+        elif line.strip() == b'':
+            pos = newline + 1
+        else:
+            size = int(line)
+            records.append((order, data[newline + 1:newline + 1 + size]))
+            order = None
+            pos = newline + 1 + size
+    return records
+
+def split_records(data):
+    return [record for order, record in split_ordered_records(data)]
+
+def parse_record(fileinfo, data):
+    if data.startswith(b'{'): parse_json(fileinfo, data)
+    elif data.startswith(b'FXR4'): parse_binary(fileinfo, data)
+    else: parse_xml(fileinfo, data)
+
+    # without liveness info every variable has to be written back, at every exit.
+    if not fileinfo.liveness:
+        for var in fileinfo.vars: 
+            var.ismodified = True
+            var.liveexits = None
+
+# Read region info in any of the formats written by the pass, from a file or stdin. 
+# With many records, picks the one given by --funcname (first one by default).
+def parse_info(fileinfo):
+    if CLI_ARGS.xml == '-': 
+        data = sys.stdin.buffer.read()
+    else:
+        f = open(CLI_ARGS.xml, 'rb')
+        data = f.read()
+        f.close()
+
+    for record in split_records(data):
+        parse_record(fileinfo, record)
+        if CLI_ARGS.funcname == None or fileinfo.funname == CLI_ARGS.funcname: return
+        fileinfo.__init__()
+    raise Exception('Region %s not found.' % CLI_ARGS.funcname)
 
 # Read original source file into two different dictionaries.
 def parse_src(fileinfo):
@@ -496,7 +825,7 @@ def parse_src(fileinfo):
 
 def main():
     fileinfo = FileInfo()
-    parse_xml(fileinfo)
+    parse_info(fileinfo)
     parse_src(fileinfo)
 
     fileinfo.try_separate_func_header()
@@ -507,7 +836,10 @@ def main():
 if __name__ == '__main__':
     parser = argparse.ArgumentParser()
     parser.add_argument('--src', help='Source code to extract region from',required=True)
-    parser.add_argument('--xml', help='XML file with region info', required=True)
+    parser.add_argument('--xml', help='File with region info (xml, jsonl or binary), - reads from stdin', required=True)
+    parser.add_argument('--funcname', help='Name of the region to extract if the file contains many records')
     parser.add_argument('--append', action='store_true', help='Append the rest of file to the output')
+    parser.add_argument('--byvalue-limit', type=int, default=16, 
+                        help='Inputs larger than this many bytes are passed by pointer instead of being copied (default 16)')
     CLI_ARGS = parser.parse_args()
     main()
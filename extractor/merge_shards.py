@@ -0,0 +1,48 @@
+import sys
+import os
+import shutil
+import argparse
+
+from extractor import split_ordered_records
+
+# Merges output of runs with --funcextract-shard=i/N into what a single run would have written.
+# Output directories are merged by copying their files, as every region has a file of its own.
+# Aggregated files are merged by putting records back in (function, region) order and dropping
+# the order lines, which gives the same bytes as an unsharded run.
+
+def merge_directories(shards, out):
+    if not os.path.isdir(out): os.makedirs(out)
+    for shard in shards:
+        for name in sorted(os.listdir(shard)):
+            shutil.copyfile(os.path.join(shard, name), os.path.join(out, name))
+
+def merge_files(shards, out):
+    records = []
+    for shard in shards:
+        with open(shard, 'rb') as f:
+            for order, record in split_ordered_records(f.read()):
+                if order is None: raise Exception(shard + ' was not written by a sharded run')
+                records.append((order, record))
+    records.sort(key=lambda r: r[0])
+
+    stream = sys.stdout.buffer if out == '-' else open(out, 'wb')
+    for order, record in records:
+        # same framing as the pass: JSON by lines, the rest prefixed with the size.
+        if record.startswith(b'{'): stream.write(record + b'\n')
+        else: stream.write(str(len(record)).encode() + b'\n' + record)
+    if stream is not sys.stdout.buffer: stream.close()
+
+def main():
+    if all(os.path.isdir(shard) for shard in CLI_ARGS.shards):
+        merge_directories(CLI_ARGS.shards, CLI_ARGS.out)
+    elif any(os.path.isdir(shard) for shard in CLI_ARGS.shards):
+        raise Exception('Cannot mix output directories with aggregated files')
+    else:
+        merge_files(CLI_ARGS.shards, CLI_ARGS.out)
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser()
+    parser.add_argument('shards', nargs='+', help='Output directories or aggregated files of all shards')
+    parser.add_argument('--out', help='Merged output directory or file, - writes to stdout', required=True)
+    CLI_ARGS = parser.parse_args()
+    main()
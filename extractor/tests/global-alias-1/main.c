@@ -0,0 +1,14 @@
+int G[65];
+
+int main() {
+	int *p = G;
+	int n = 64;
+
+	int i = 0;
+	while (i < 65) { G[i] = i * 3; i++; }
+	for (i = 0; i < n; i++) {
+		p[i] = G[i + 1] + 1;
+	}
+
+	return (G[0] + G[10] + G[63]) % 251;
+}
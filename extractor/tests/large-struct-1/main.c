@@ -0,0 +1,21 @@
+struct big { int b[512]; int n; };
+
+int main() {
+	struct big b;
+	int out = 0;
+	char c = 0;
+	short h = 0;
+	double d = 0.5;
+	b.n = 512;
+
+	int i;
+	for (i = 0; i < b.n; i++) {
+		b.b[i] = i;
+		out += b.b[i] % 7;
+		c = (char)(c + 1);
+		h = (short)(h + 3);
+		d = d * 0.5 + i;
+	}
+
+	return (out + b.b[3] + c + h + (int)d) % 251;
+}
@@ -0,0 +1,19 @@
+int main() {
+	int s = 0;
+	int m = 0;
+	int t = 0;
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		t = s * 2;
+		s = s + (i * 5 + 3) % 11;
+		if (s > 40) {
+			m = i + t;
+			goto found;
+		}
+	}
+	m = 99;
+
+found:
+	return (s * 7 + m + i) % 251;
+}
@@ -0,0 +1,10 @@
+int sum(int *a, int n) {
+	int s = 0;
+	for (int i = 0; i < n; i++) { s = s + a[i]; }
+	return s;
+}
+
+int main() {
+	int a[16] = {3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5, 8, 9, 7, 9, 3};
+	return sum(a, 16) % 251;
+}
@@ -0,0 +1,13 @@
+int main() {
+	int a[32] = {3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5, 8, 9, 7, 9, 3};
+	int s = 0;
+	int m = 0;
+
+	int i;
+	for (i = 0; i < 32; i++) {
+		s += a[i];
+		if (a[i] > m) m = a[i];
+	}
+
+	return s * m % 251;
+}
@@ -0,0 +1,15 @@
+struct big { int b[512]; int n; };
+
+int main() {
+	struct big b;
+	int s = 0;
+	b.n = 512;
+
+	int i = 0;
+	while (i < 512) { b.b[i] = i; i++; }
+	for (i = 0; i < b.n; i++) {
+		s += b.b[i] % 7;
+	}
+
+	return s % 251;
+}
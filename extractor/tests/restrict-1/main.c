@@ -0,0 +1,14 @@
+int main() {
+	float a[64], b[64], c[64];
+	float *out = c;
+	float *q = a + 1;
+	int n = 60;
+
+	int i = 0;
+	while (i < 64) { a[i] = i; b[i] = 2 * i; i++; }
+	for (i = 0; i < n; i++) {
+		out[i] = a[i] + b[i] + q[i];
+	}
+
+	return (int)(c[3] + c[59]) % 251;
+}
@@ -0,0 +1,14 @@
+int main() {
+	int a[16];
+	int *p = a;
+	int *q = a;
+	int **pp = &q;
+
+	int i = 0;
+	while (i < 16) { a[i] = i; i++; }
+	for (i = 0; i < 15; i++) {
+		p[i + 1] = (*pp)[i] + 1;
+	}
+
+	return (a[7] + a[15]) % 251;
+}
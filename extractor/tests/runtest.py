@@ -5,8 +5,8 @@ import xml.etree.cElementTree as ET
 # small test runner. 
 # Since FuncExtract pass outputs XML, we need a separate program to compare actual output XML
 # with expected XML
-OPT   = 'opt -load ../../../../../../build/lib/FuncExtract.so -funcextract --bblist=%s --out=%s %s -o /dev/null'
-CLANG = 'clang -emit-llvm -S -O0 -g %s -o %s'
+OPT   = 'opt -load ../../../../../../build/lib/FuncExtract.so -funcextract %s --bblist=%s --out=%s %s -o /dev/null'
+CLANG = 'clang -emit-llvm -S %s -g %s -o %s'
 EXTRACTOR = 'python ../extractor.py --src %s --xml %s --append > %s'
 CLANGCOMPILE = 'clang -O0 %s -o %s'
 
@@ -18,6 +18,7 @@ TESTFILES = [
     'const-qualifier-1/', 'main.c', 'region.txt', 'main_ifend_ifend7.xml',
     'static-1/', 'main.c', 'region.txt', 'main_ifend_ifend7.xml',
     'static-2/', 'main.c', 'region.txt', 'main_ifend_ifend7.xml',
+    'static-3/', 'main.c', 'region.txt', 'step_forcond_forend.xml',
     'goto-1/', 'main.c', 'region.txt', 'main_entry_myreturnlabel.xml',
     'const-fn-pointer-1/', 'main.c', 'region.txt', 'main_ifend_ifend7.xml',
     'array-1/', 'main.c', 'region.txt', 'main_forcond_forend.xml',
@@ -26,8 +27,39 @@ TESTFILES = [
     'array-4/', 'main.c', 'region.txt', 'main_ifend_ifend13.xml',
     'multiline-args/', 'main.c', 'region.txt', 'myfunction_forcond_forend.xml',
     'lit-brace-1/', 'main.c', 'region.txt', 'main_forcond_forend.xml',
+    'large-struct-1/', 'main.c', 'region.txt', 'main_forcond_forend.xml',
+    'restrict-1/', 'main.c', 'region.txt', 'main_forcond_forend.xml',
+    'restrict-2/', 'main.c', 'region.txt', 'main_forcond_forend.xml',
+    'global-alias-1/', 'main.c', 'region.txt', 'main_forcond_forend.xml',
+    'pure-1/', 'main.c', 'region.txt', 'main_forcond_forend.xml',
+    'pure-2/', 'main.c', 'region.txt', 'main_forcond_forend.xml',
+    'optimized-1/', 'main.c', 'region.txt', 'sum_entry_fnend.xml',
+    'selectors-1/', 'main.c', 'region.txt', 'main_forcond_forend.xml',
+    'liveness-1/', 'main.c', 'region.txt', 'main_forcond_found.xml',
 ]
 
+# optimization level regions are found in, -O0 unless listed here.
+OPTLEVEL = {
+    'optimized-1/': '-O1',
+}
+
+# extra pass options of the test.
+OPTFLAGS = {
+    'liveness-1/': '-funcextract-liveness',
+}
+
+# text the extracted source has to contain (True) or must not contain (False), whitespace ignored.
+DECLARATIONS = {
+    'restrict-1/': [ ('float*restrictout', True), ('float(b)[restrict64]', True),
+                     ('float*restrictq', False), ('float(a)[restrict', False), ],
+    'restrict-2/': [ ('int*restrictp', False), ],
+    'global-alias-1/': [ ('int*restrictp', False), ],
+    'large-struct-1/': [ ('structbig*b_ptr', True),
+                         ('{doubled;inti;intout;shorth;charc;}', True), ],
+    'pure-1/': [ ('__attribute__((pure', True), ],
+    'pure-2/': [ ('structbig*b_ptr', True), ('__attribute__((const', False), ('__attribute__((pure', False), ],
+}
+
 TEMPFILES = ['.temp/', 'temp.ll', 'extracted.c', 'extracted.out', 'original.out']
 
 def run_process(args): 
@@ -35,6 +67,12 @@ def run_process(args):
     process.communicate()[0] 
     return process.returncode
 
+def check_declarations(test, extractsrc):
+    text = ''.join(open(extractsrc).read().split())
+    for decl, present in DECLARATIONS.get(test, []):
+        if (decl in text) != present: return '%s %s' % ('missing' if present else 'unexpected', decl)
+    return ''
+
 # We test this by first extracting the region, and then compiling + running both original and extracted 
 # region.
 def runpass():
@@ -53,11 +91,11 @@ def runpass():
         #if not os.path.isfile(region): raise Exception(region   + ' missing, exiting')
 
         #compile to llvm ir
-        clangcmd = CLANG % (source, llvmirfile)
+        clangcmd = CLANG % (OPTLEVEL.get(TESTFILES[i], '-O0'), source, llvmirfile)
         subprocess.call(clangcmd, shell=True)
 
         # run opt pass
-        optcmd = OPT % (region, TEMPFILES[0], llvmirfile)
+        optcmd = OPT % (OPTFLAGS.get(TESTFILES[i], ''), region, TEMPFILES[0], llvmirfile)
         subprocess.call(optcmd, shell=True)
 
         # run code extractor! 
@@ -75,7 +113,10 @@ def runpass():
         # run both 
         extractretval  = run_process([execextract])
         originalretval = run_process([execoriginal])
-        if (extractretval != originalretval):
+        declstatus = check_declarations(TESTFILES[i], extractsrc)
+        if declstatus != '':
+            print('FAIL %s: Declaration mismatch - %s' % (TESTFILES[i], declstatus))
+        elif (extractretval != originalretval):
             print('FAIL %s: Retcode mismatch - expected: %s, actual: %s' % (TESTFILES[i], originalretval, extractretval))
         else: 
             print('PASS %s: %s %s' % (TESTFILES[i], originalretval, extractretval))
@@ -0,0 +1,11 @@
+int main() {
+	int a[16] = {3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5, 8, 9, 7, 9, 3};
+	int s = 0;
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		s = s + a[i] * i;
+	}
+
+	return s % 251;
+}
@@ -0,0 +1,18 @@
+int step(int x) {
+	static int total = 0;
+	int i;
+	for (i = 0; i < x; i++) {
+		total = total + i + 1;
+		if (total > 20) {
+			return total;
+		}
+	}
+	return -1;
+}
+
+int main() {
+	int s = 0;
+	int k;
+	for (k = 0; k < 12; k++) { s += step(k); }
+	return s % 251;
+}
@@ -0,0 +1,26 @@
+// Compiled with -funcextract-liveness. The region is left through a goto and by falling
+// through, both exits need s, i and m afterwards, t is dead after the region.
+// INPUTS: s, i, m, t
+// MODIFIED: s, i, m
+// LOCAL: m, t (written before they are read)
+int test1(void) {
+	int s = 0;
+	int m = 0;
+	int t = 0;
+	int i;
+
+//---region start
+	for (i = 0; i < 16; i++) {
+		t = s * 2;
+		s = s + (i * 5 + 3) % 11;
+		if (s > 40) {
+			m = i + t;
+			goto found;
+		}
+	}
+	m = 99;
+//---region end
+
+found:
+	return (s * 7 + m + i) % 251;
+}
@@ -0,0 +1,43 @@
+// memory effects of regions. Expected XMLs list readnone / readonly of the region.
+int g[16];
+
+// touches nothing but its own variables.
+// INPUTS: n, s, i
+int test1(int n) {
+	int s = 0;
+	int i;
+	for (i = 0; i < n; i++) { s = s + i * i; }
+	return s;
+}
+
+// reads an array coming in.
+// INPUTS: a, s, i
+int test2(void) {
+	int a[16];
+	int s = 0;
+	int i = 0;
+	while (i < 16) { a[i] = i; i++; }
+	for (i = 0; i < 16; i++) { s = s + a[i]; }
+	return s;
+}
+
+// writes through a pointer coming in.
+// INPUTS: p, i
+void test3(int *p) {
+	int i;
+	for (i = 0; i < 16; i++) { p[i] = i; }
+}
+
+// reads a global.
+// INPUTS: s, i
+int test4(void) {
+	int s = 0;
+	int i;
+	for (i = 0; i < 16; i++) { s = s + g[i]; }
+	return s;
+}
+
+int main() {
+	test3(g);
+	return (test1(5) + test2() + test4()) % 251;
+}
@@ -0,0 +1,26 @@
+// Compiled with -O1: locals live in registers and are only known through llvm.dbg.value.
+// Regions are whole functions, whose block names do not depend on the optimizer.
+
+// INPUTS: a, n, s
+// s is described by the phi of the loop, i is declared inside of the region.
+int test1(int *a, int n) {
+	int s = 0;
+//---region start
+	for (int i = 0; i < n; i++) { s = s + a[i]; }
+	return s;
+//---region end
+}
+
+// INPUTS: x, scale
+// scale has no storage at all, its only dbg.value binds the literal.
+int test2(int x) {
+	const int scale = 3;
+//---region start
+	return x * scale;
+//---region end
+}
+
+int main(void) {
+	int a[4] = { 1, 2, 3, 4 };
+	return test1(a, 4) + test2(5);
+}
@@ -0,0 +1,63 @@
+// restrict, nonnull and alignment of what pointer inputs point to. Expected XMLs only 
+// list the facts of pointers, 0 where the fact must not be reported.
+float g[64];
+
+// restrict parameters point to distinct objects, nothing is known about their values.
+// INPUTS: x, y, n, i
+void test1(float *restrict x, float *restrict y, int n) {
+	int i;
+	for (i = 0; i < n; i++) { y[i] = x[i] * 2.0f; }
+}
+
+// pointers into distinct local arrays, one of them past the first element.
+// INPUTS: p, q, s, i
+float test2(void) {
+	float a[64], b[64];
+	float *p = a;
+	float *q = b + 1;
+	float s = 0;
+	int i = 0;
+	while (i < 64) { a[i] = i; b[i] = i; i++; }
+	for (i = 0; i < 63; i++) { s = s + p[i] * q[i]; }
+	return s;
+}
+
+// pointers into the same array.
+// INPUTS: p, q, i
+float test3(void) {
+	float a[64];
+	float *p = a;
+	float *q = a + 1;
+	int i = 0;
+	while (i < 64) { a[i] = i; i++; }
+	for (i = 0; i < 63; i++) { p[i] = q[i] + 1; }
+	return a[0];
+}
+
+// pointer to a global the region also reads by name.
+// INPUTS: p, i
+void test4(void) {
+	float *p = g;
+	int i;
+	for (i = 0; i < 63; i++) { p[i] = g[i + 1]; }
+}
+
+// what a pointer to pointer points to is not followed, p may alias *pp.
+// INPUTS: p, pp, i
+float test5(void) {
+	float a[64];
+	float *p = a;
+	float *q = a;
+	float **pp = &q;
+	int i = 0;
+	while (i < 64) { a[i] = i; i++; }
+	for (i = 0; i < 63; i++) { p[i + 1] = (*pp)[i]; }
+	return a[63];
+}
+
+int main() {
+	float x[64] = { 1 }, y[64];
+	test1(x, y, 64);
+	test4();
+	return (int)(test2() + test3() + test5() + g[0]) % 251;
+}
@@ -1,15 +1,38 @@
 import subprocess
 import os
 import sys
+import filecmp
 import xml.etree.cElementTree as ET
+sys.path.append('../extractor')
+import extractor
 # small test runner. 
 # Since FuncExtract pass outputs XML, we need a separate program to compare actual output XML
 # with expected XML
-OPT   = 'opt -load ../../../../../build/lib/FuncExtract.so -funcextract --bblist=%s --out=%s %s -o /dev/null'
-#OPT   = 'opt -load ../../../../../build/lib/FuncExtract.so -funcextract --bblist=%s --out=%s %s -o /dev/null &> /dev/null'
-CLANG = 'clang -emit-llvm -S -O0 -g %s -o %s'
+OPT   = 'opt -load ../../../../../build/lib/FuncExtract.so -funcextract %s --bblist=%s --out=%s %s -o /dev/null'
+#OPT   = 'opt -load ../../../../../build/lib/FuncExtract.so -funcextract %s --bblist=%s --out=%s %s -o /dev/null &> /dev/null'
+CLANG = 'clang -emit-llvm -S %s -g %s -o %s'
+OPTMODULE = 'opt -load ../../../../../build/lib/FuncExtract.so -funcextract-module %s --bblist=%s --out=%s %s -o /dev/null'
+MERGE = 'python ../extractor/merge_shards.py --out=%s %s'
 tempfiles = ['.temp/', 'out.ll'] 
 
+# optimization level tests are compiled with, -O0 unless listed here.
+OPTLEVEL = {
+    'optimized-1/': '-O1',
+}
+
+# extra pass options of the test.
+OPTFLAGS = {
+    'liveness-1/': '-funcextract-liveness',
+}
+
+# every test is run once per configuration, all of them have to match the same expected XML.
+CONFIGS = [
+    'scan/',        '',
+    'uses/',        '-funcextract-engine=uses',
+    'summary/',     '-funcextract-engine=summary',
+    'all-regions/', '-funcextract-all-regions',
+]
+
 
 TESTFILES = [
     'general-1/', 'main.c', 'regions.txt',
@@ -20,6 +43,13 @@ TESTFILES = [
     'type-array/',       'main.c', 'regions.txt',
     'type-fn-pointers/', 'main.c', 'regions.txt',
     'bad-cases/',        'main.c', 'regions.txt',
+    'optimized-1/',      'main.c', 'regions.txt',
+    'selectors-1/',      'main.c', 'regions.txt',
+    'selectors-1/',      'main.c', 'everything.txt',
+    'liveness-1/',       'main.c', 'regions.txt',
+    'pointer-facts-1/',  'main.c', 'regions.txt',
+    'memory-effects-1/', 'main.c', 'regions.txt',
+    'static-scope-1/',   'main.c', 'regions.txt',
 ]
 
 TESTCASES = {
@@ -94,9 +124,39 @@ TESTCASES = {
 
     'bad-cases/': [ 'test1_forcond_forend.xml', 'EXPECTED',
                     'test3_forend_ifend.xml'  , '',
-                    'test2_forcond_forend.xml', 'EXPECTED', ]
+                    'test2_forcond_forend.xml', 'EXPECTED', ],
+
+    'optimized-1/': [ 'test1_entry_fnend.xml', '',
+                      'test2_entry_fnend.xml', '', ],
+
+    'selectors-1/': [ 'test1_forcond_forend.xml'    , '',
+                      'test2_sum_forcond_forend.xml', '',
+                      'test3_a_forcond_forend.xml'  , '',
+                      'test3_b_forcond_forend.xml'  , '',
+                      'test4_forcond_forend.xml'    , '',
+                      'test5_forcond_forend.xml'    , '',
+                      'test6_forcond_forend.xml'    , '', ],
+
+    'liveness-1/': [ 'test1_forcond_found.xml', '', ],
+
+    'pointer-facts-1/': [ 'test1_forcond_forend.xml', '',
+                          'test2_forcond_forend.xml', '',
+                          'test3_forcond_forend.xml', '',
+                          'test4_forcond_forend.xml', '',
+                          'test5_forcond_forend.xml', '', ],
+
+    'memory-effects-1/': [ 'test1_forcond_forend.xml', '',
+                           'test2_forcond_forend.xml', '',
+                           'test3_forcond_forend.xml', '',
+                           'test4_forcond_forend.xml', '', ],
+
+    'static-scope-1/': [ 'test1_forcond_forend.xml', '', ],
 }
 
+# facts compared only where the expected XML states them, 0 meaning the pass must not report it.
+FACTS = ['size', 'align', 'isrestrict', 'isnonnull', 'pointeralign']
+REGIONFACTS = ['readnone', 'readonly']
+
 class VariableInfo:
     def __init__(self):
         self.name = ''
@@ -105,6 +165,10 @@ class VariableInfo:
         self.isstatic = False
         self.isconstq = False
         self.isarrayt = False
+        self.ismodified = False
+        self.islocal = False
+        self.numliveexits = 0 # exit lines depend on where clang puts the branches, only their number is compared.
+        self.facts = {}       # FACTS present in the XML.
 
     def compare_with_error(self, other):
         if self.name != other.name: return 'Name mismatch: %s %s' % (self.name, other.name)
@@ -113,6 +177,11 @@ class VariableInfo:
         if self.isstatic != other.isstatic: return 'isstatic mismatch: %s %s' % (self.isstatic, other.isstatic)
         if self.isconstq != other.isconstq: return 'isconstq mismatch: %s %s' % (self.isconstq, other.isconstq)
         if self.isarrayt != other.isarrayt: return 'isarrayt mismatch: %s %s' % (self.isarrayt, other.isarrayt)
+        if self.ismodified != other.ismodified: return 'ismodified mismatch: %s %s' % (self.ismodified, other.ismodified)
+        if self.islocal != other.islocal: return 'islocal mismatch: %s %s' % (self.islocal, other.islocal)
+        if self.numliveexits != other.numliveexits: return 'liveexit count mismatch: %s %s' % (self.numliveexits, other.numliveexits)
+        for fact in self.facts:
+            if self.facts[fact] != other.facts.get(fact, 0): return '%s mismatch: %s %s' % (fact, self.facts[fact], other.facts.get(fact, 0))
         return '' 
 
 ## reads variable info from XML. expects to have both name and type. 
@@ -128,9 +197,29 @@ def xmlgetvariableinfo(filepath):
             if child.find('isstatic') != None: var.isstatic = bool(int(child.find('isstatic').text))
             if child.find('isconstq') != None: var.isconstq = bool(int(child.find('isconstq').text))
             if child.find('isarrayt') != None: var.isarrayt = bool(int(child.find('isarrayt').text))
+            if child.find('ismodified') != None: var.ismodified = bool(int(child.find('ismodified').text))
+            if child.find('islocal') != None: var.islocal = bool(int(child.find('islocal').text))
+            var.numliveexits = len(child.findall('liveexit'))
+            for fact in FACTS:
+                if child.find(fact) != None: var.facts[fact] = int(child.find(fact).text)
             out.append(var)
     return out 
 
+## reads REGIONFACTS of the region from XML.
+def xmlgetregionfacts(filepath):
+    out = {}
+    root = ET.parse(filepath).getroot()
+    for fact in REGIONFACTS:
+        if root.find(fact) != None: out[fact] = int(root.find(fact).text)
+    return out
+
+
+def cmpregion(source, expect, actual):
+    for fact in expect:
+        if expect[fact] != actual.get(fact, 0): 
+            return 'FAIL %s: %s mismatch: %s %s\n' % (source, fact, expect[fact], actual.get(fact, 0))
+    return ''
+
 
 def cmpvars(source, expect, actual):
     ## compare lengths first...
@@ -147,35 +236,183 @@ def cmpvars(source, expect, actual):
 
 
 def runtests():
-    subprocess.call(['rm', '-rf', tempfiles[0]]) #remove temp dir
-    subprocess.call(['mkdir', tempfiles[0]]) ##mkdir temp directory
     for i in range(0, len(TESTFILES), 3):
+        # start from an empty temp dir, the same directory may be run with several region lists.
+        subprocess.call(['rm', '-rf', tempfiles[0]]) #remove temp dir
+        subprocess.call(['mkdir', tempfiles[0]]) ##mkdir temp directory
         source = TESTFILES[i] + TESTFILES[i+1]
         region = TESTFILES[i] + TESTFILES[i+2]
         outsrc = tempfiles[0] + tempfiles[1]
-        outdir = tempfiles[0]
 
         ## gotta confirm those files exist...
         if not os.path.isfile(source): raise Exception(source   + ' missing, exiting')
         if not os.path.isfile(region): raise Exception(region   + ' missing, exiting')
 
         #compile to llvm ir
-        clangcmd = CLANG % (source, outsrc)
+        clangcmd = CLANG % (OPTLEVEL.get(TESTFILES[i], '-O0'), source, outsrc)
         subprocess.call(clangcmd, shell=True)
 
-        # run opt pass
-        optcmd = OPT % (region, tempfiles[0], outsrc)
-        subprocess.call(optcmd, shell=True)
+        for k in range(0, len(CONFIGS), 2):
+            # run opt pass, each configuration writes into its own directory.
+            outdir = tempfiles[0] + CONFIGS[k]
+            subprocess.call(['mkdir', '-p', outdir])
+            optcmd = OPT % (CONFIGS[k+1] + ' ' + OPTFLAGS.get(TESTFILES[i], ''), region, outdir, outsrc)
+            subprocess.call(optcmd, shell=True)
+
+            testcases = TESTCASES[TESTFILES[i]]
+            for j in range(0, len(testcases), 2):
+                outxml = outdir + testcases[j] 
+                corxml = TESTFILES[i] + testcases[j]
+
+                expect = xmlgetvariableinfo(corxml)
+                actual = xmlgetvariableinfo(outxml)
+
+                name = CONFIGS[k] + source + ':' + testcases[j]
+                status = cmpregion(name, xmlgetregionfacts(corxml), xmlgetregionfacts(outxml))
+                if status == '': status = cmpvars(name, expect, actual)
+                status = "%s%s" % (testcases[j+1], status)
+                sys.stdout.write(status)
+
+# every region of these tests is extracted once in a single run and once split into SHARDS, 
+# shards merged by extractor/merge_shards.py have to give the same files / bytes.
+SHARDS = 3
+SHARDTESTS = ['general-1/', 'type-struct/']
+SHARDFORMATS = ['xml', 'jsonl', 'binary']
+
+def runsharded(flags, region, outsrc, single, shards, merged):
+    subprocess.call(OPTMODULE % (flags, region, single, outsrc), shell=True)
+    for i in range(len(shards)):
+        shardflags = '%s -funcextract-shard=%d/%d' % (flags, i, len(shards))
+        subprocess.call(OPTMODULE % (shardflags, region, shards[i], outsrc), shell=True)
+    subprocess.call(MERGE % (merged, ' '.join(shards)), shell=True)
+
+def runshards():
+    for test in SHARDTESTS:
+        subprocess.call(['rm', '-rf', tempfiles[0]]) #remove temp dir
+        subprocess.call(['mkdir', tempfiles[0]]) ##mkdir temp directory
+        source = test + 'main.c'
+        region = test + 'regions.txt'
+        outsrc = tempfiles[0] + tempfiles[1]
+        subprocess.call(CLANG % ('-O0', source, outsrc), shell=True)
+
+        # a file per region, shard directories are merged by copying.
+        single = tempfiles[0] + 'single/'
+        merged = tempfiles[0] + 'merged/'
+        shards = [tempfiles[0] + 'shard%d/' % i for i in range(SHARDS)]
+        for outdir in [single] + shards: subprocess.call(['mkdir', '-p', outdir])
+        runsharded('-funcextract-all-regions', region, outsrc, single, shards, merged)
+        names = sorted(os.listdir(single))
+        match, mismatch, errors = filecmp.cmpfiles(single, merged, names, shallow=False)
+        if len(names) != len(os.listdir(merged)) or mismatch or errors:
+            sys.stdout.write('FAIL shards %s: directories differ: %s\n' % (source, mismatch + errors))
+        else:
+            sys.stdout.write('PASS shards %s: %d files\n' % (source, len(names)))
+
+        # aggregated records of every format.
+        for fmt in SHARDFORMATS:
+            single = tempfiles[0] + 'single.' + fmt
+            merged = tempfiles[0] + 'merged.' + fmt
+            shards = [tempfiles[0] + 'shard%d.%s' % (i, fmt) for i in range(SHARDS)]
+            flags = '-funcextract-all-regions -funcextract-aggregate -funcextract-format=' + fmt
+            runsharded(flags, region, outsrc, single, shards, merged)
+            if not os.path.isfile(merged) or not filecmp.cmp(single, merged, shallow=False):
+                sys.stdout.write('FAIL shards %s: merged %s differs\n' % (source, fmt))
+            else:
+                sys.stdout.write('PASS shards %s: %s\n' % (source, fmt))
+
+# regions are extracted twice with a cache directory, the second run reads the records cached 
+# by the first and has to write the same files. Then the IR is edited, which must not be answered 
+# from the cache: output has to match a run without the cache and differ from the original.
+# test directory, text replaced in the IR, replacement, file expected to change.
+CACHETESTS = [
+    'memory-effects-1/', '@test3(i32* %p)', '@test3(i32* nonnull %p)', 'test3_forcond_forend.xml',
+]
+
+def cmpdirs(a, b):
+    names = sorted(os.listdir(a))
+    match, mismatch, errors = filecmp.cmpfiles(a, b, names, shallow=False)
+    return len(names) == len(os.listdir(b)) and not mismatch and not errors
+
+def runcache():
+    for i in range(0, len(CACHETESTS), 4):
+        subprocess.call(['rm', '-rf', tempfiles[0]]) #remove temp dir
+        subprocess.call(['mkdir', tempfiles[0]]) ##mkdir temp directory
+        source = CACHETESTS[i] + 'main.c'
+        region = CACHETESTS[i] + 'regions.txt'
+        outsrc = tempfiles[0] + tempfiles[1]
+        edited = tempfiles[0] + 'edited.ll'
+        cache  = tempfiles[0] + 'cache/'
+        subprocess.call(CLANG % ('-O0', source, outsrc), shell=True)
+        with open(outsrc) as f: ir = f.read()
+        if CACHETESTS[i+1] not in ir: raise Exception(CACHETESTS[i+1] + ' not found in IR of ' + source)
+        with open(edited, 'w') as f: f.write(ir.replace(CACHETESTS[i+1], CACHETESTS[i+2]))
+
+        runs = [('first/', outsrc, cache), ('second/', outsrc, cache), ('edited/', edited, cache), ('uncached/', edited, '')]
+        for outdir, ir, cachedir in runs:
+            subprocess.call(['mkdir', '-p', tempfiles[0] + outdir, cache])
+            flags = '-funcextract-cache=' + cachedir if cachedir != '' else ''
+            subprocess.call(OPT % (flags, region, tempfiles[0] + outdir, ir), shell=True)
+
+        changed = CACHETESTS[i+3]
+        if len(os.listdir(cache)) == 0:
+            sys.stdout.write('FAIL cache %s: nothing cached\n' % source)
+        elif not cmpdirs(tempfiles[0] + 'first/', tempfiles[0] + 'second/'):
+            sys.stdout.write('FAIL cache %s: cached run differs\n' % source)
+        elif not cmpdirs(tempfiles[0] + 'edited/', tempfiles[0] + 'uncached/'):
+            sys.stdout.write('FAIL cache %s: stale records after edit\n' % source)
+        elif filecmp.cmp(tempfiles[0] + 'first/' + changed, tempfiles[0] + 'edited/' + changed, shallow=False):
+            sys.stdout.write('FAIL cache %s: %s did not change after edit\n' % (source, changed))
+        else:
+            sys.stdout.write('PASS cache %s\n' % source)
+
+# every test is also written aggregated in these formats. extractor.py has to read back the same
+# records from them as from the XML files of a plain run.
+FORMATS = ['jsonl', 'binary']
+
+def readrecord(data):
+    fileinfo = extractor.FileInfo()
+    if data.startswith(b'{'): extractor.parse_json(fileinfo, data)
+    elif data.startswith(b'FXR4'): extractor.parse_binary(fileinfo, data)
+    else: extractor.parse_xml(fileinfo, data)
+    return (fileinfo.funname, fileinfo.funrettype.strip(), fileinfo.reginfo, fileinfo.funinfo, fileinfo.exitlocs, 
+            fileinfo.toplevel, fileinfo.liveness, fileinfo.readnone, fileinfo.readonly, [var.__dict__ for var in fileinfo.vars])
+
+def runformats():
+    for i in range(0, len(TESTFILES), 3):
+        subprocess.call(['rm', '-rf', tempfiles[0]]) #remove temp dir
+        subprocess.call(['mkdir', tempfiles[0]]) ##mkdir temp directory
+        source = TESTFILES[i] + TESTFILES[i+1]
+        region = TESTFILES[i] + TESTFILES[i+2]
+        outsrc = tempfiles[0] + tempfiles[1]
+        subprocess.call(CLANG % (OPTLEVEL.get(TESTFILES[i], '-O0'), source, outsrc), shell=True)
 
-        testcases = TESTCASES[TESTFILES[i]]
-        for j in range(0, len(testcases), 2):
-            outxml = tempfiles[0] + testcases[j] 
-            corxml = TESTFILES[i] + testcases[j]
+        xmldir = tempfiles[0] + 'xml/'
+        subprocess.call(['mkdir', '-p', xmldir])
+        subprocess.call(OPT % (OPTFLAGS.get(TESTFILES[i], ''), region, xmldir, outsrc), shell=True)
+        names = sorted(os.listdir(xmldir))
 
-            expect = xmlgetvariableinfo(corxml)
-            actual = xmlgetvariableinfo(outxml)
+        for fmt in FORMATS:
+            out = tempfiles[0] + 'all.' + fmt
+            flags = '%s -funcextract-aggregate -funcextract-format=%s' % (OPTFLAGS.get(TESTFILES[i], ''), fmt)
+            subprocess.call(OPT % (flags, region, out, outsrc), shell=True)
+            with open(out, 'rb') as f: records = extractor.split_records(f.read())
 
-            status = "%s%s" % (testcases[j+1], cmpvars(source+':'+testcases[j], expect, actual))
+            status = 'PASS %s %s: %d records\n' % (fmt, source, len(records))
+            if len(records) != len(names): 
+                status = 'FAIL %s %s: expected %d records, actual %d\n' % (fmt, source, len(names), len(records))
+            for record in records:
+                actual = readrecord(record)
+                xmlfile = xmldir + actual[0] + '.xml'
+                if not os.path.isfile(xmlfile): 
+                    status = 'FAIL %s %s: unexpected record %s\n' % (fmt, source, actual[0])
+                    break
+                with open(xmlfile, 'rb') as f: expect = readrecord(f.read())
+                if expect != actual:
+                    status = 'FAIL %s %s: record %s differs from XML\n' % (fmt, source, actual[0])
+                    break
             sys.stdout.write(status)
 
 runtests()
+runformats()
+runshards()
+runcache()
@@ -0,0 +1,103 @@
+// Same loop in every function, each selected by a different kind of region list line,
+// see regions.txt. everything.txt selects all of them with a single "*" line.
+// INPUTS: a, n, s, i
+
+// selected by exact name.
+int test1(int *a, int n) {
+	int s = 0;
+	int i;
+//---region start
+	for (i = 0; i < n; i++) {
+		s = s + a[i];
+	}
+//---region end
+	return s;
+}
+
+// selected by glob.
+int test2_sum(int *a, int n) {
+	int s = 0;
+	int i;
+//---region start
+	for (i = 0; i < n; i++) {
+		s = s + a[i];
+	}
+//---region end
+	return s;
+}
+
+// selected by regular expression.
+int test3_a(int *a, int n) {
+	int s = 0;
+	int i;
+//---region start
+	for (i = 0; i < n; i++) {
+		s = s + a[i];
+	}
+//---region end
+	return s;
+}
+
+// selected by regular expression.
+int test3_b(int *a, int n) {
+	int s = 0;
+	int i;
+//---region start
+	for (i = 0; i < n; i++) {
+		s = s + a[i];
+	}
+//---region end
+	return s;
+}
+
+// selected by line range.
+int test4(int *a, int n) {
+	int s = 0;
+	int i;
+//---region start
+	for (i = 0; i < n; i++) {
+		s = s + a[i];
+	}
+//---region end
+	return s;
+}
+
+// selected by file and line range.
+int test5(int *a, int n) {
+	int s = 0;
+	int i;
+//---region start
+	for (i = 0; i < n; i++) {
+		s = s + a[i];
+	}
+//---region end
+	return s;
+}
+
+// selected by every region of the function.
+int test6(int *a, int n) {
+	int s = 0;
+	int i;
+//---region start
+	for (i = 0; i < n; i++) {
+		s = s + a[i];
+	}
+//---region end
+	return s;
+}
+
+// not selected by any line but the "*" one.
+int test3_c(int *a, int n) {
+	int s = 0;
+	int i;
+	for (i = 0; i < n; i++) {
+		s = s + a[i];
+	}
+	return s;
+}
+
+int main(void) {
+	int a[4] = { 1, 2, 3, 4 };
+	return test1(a, 4) + test2_sum(a, 4) + test3_a(a, 4) + test3_b(a, 4) + 
+		   test4(a, 4) + test5(a, 4) + test6(a, 4) + test3_c(a, 4);
+}
@@ -0,0 +1,9 @@
+// h is declared on line 9, which is also a line of test1 in main.c.
+
+
+
+
+
+
+
+int h = 1;
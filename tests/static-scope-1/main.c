@@ -0,0 +1,13 @@
+// statics are told apart from globals by their scope, not by the line they are declared on.
+#include "globals.h"
+
+// h comes from the header, on a line that falls inside test1.
+// INPUTS: n, i, t
+int test1(int n) {
+	int i;
+	static int t;
+	for (i = 0; i < n; i++) { t = t + h; }
+	return t;
+}
+
+int main() { return test1(3) != 3; }
@@ -0,0 +1,266 @@
+// runs region extraction over a whole project described by compile_commands.json. Every
+// translation unit is compiled to bitcode by clang and then analysed in-process (see
+// tools/funcextract). Translation units are spread over a fixed number of threads, so
+// compiling one file overlaps with analysing and writing regions of the others.
+#include "FuncExtract.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/YAMLParser.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace llvm;
+
+static cl::opt<std::string> CompileCommands(cl::Positional,
+			cl::desc("<compile_commands.json>"), cl::Required);
+
+static cl::opt<unsigned> Jobs("j",
+			cl::desc("Number of translation units processed at once, 0 means one per core."),
+			cl::init(0));
+
+static cl::opt<std::string> ClangPath("clang",
+			cl::desc("Compiler used to produce bitcode. Searched for in PATH by default."),
+			cl::value_desc("path"), cl::init("clang"));
+
+namespace {
+	struct CompileCommand {
+		std::string directory;
+		std::string file;
+		std::vector<std::string> arguments; // including the compiler itself.
+	};
+
+	static std::mutex errorlock; // keeps messages of different threads apart.
+}
+
+static bool parseCompileCommands(const std::string&, std::vector<CompileCommand>&);
+static std::vector<std::string> splitCommandLine(StringRef);
+static std::vector<std::string> getBitcodeArguments(const CompileCommand&, const std::string&, const std::string&);
+static std::string getFilePrefix(const CompileCommand&);
+static void processCommand(const CompileCommand&, const std::string&, const std::shared_ptr<const funcextract::RegionList>&);
+
+// splits "command" entry the way shell would, handling quotes and backslash escapes.
+static std::vector<std::string> splitCommandLine(StringRef command) {
+	std::vector<std::string> out;
+	std::string current;
+	bool inarg = false;
+	char quote = 0;
+	for (unsigned i = 0; i < command.size(); i++) {
+		char c = command[i];
+		if (c == '\\' && quote != '\'' && i + 1 < command.size()) { current += command[++i]; inarg = true; continue; }
+		if (quote) {
+			if (c == quote) { quote = 0; }
+			else { current += c; }
+			continue;
+		}
+		if (c == '"' || c == '\'') { quote = c; inarg = true; continue; }
+		if (isspace(static_cast<unsigned char>(c))) {
+			if (inarg) { out.push_back(current); }
+			current.clear();
+			inarg = false;
+			continue;
+		}
+		current += c;
+		inarg = true;
+	}
+	if (inarg) { out.push_back(current); }
+	return out;
+}
+
+static bool parseCompileCommands(const std::string& filename, std::vector<CompileCommand>& commands) {
+	ErrorOr<std::unique_ptr<MemoryBuffer>> buffer = MemoryBuffer::getFile(filename);
+	if (!buffer) {
+		errs() << "Could not read " << filename << ": " << buffer.getError().message() << "\n";
+		return false;
+	}
+
+	// JSON is a subset of YAML, same as clang's JSONCompilationDatabase does.
+	SourceMgr SM;
+	yaml::Stream stream((*buffer)->getBuffer(), SM);
+	yaml::document_iterator doc = stream.begin();
+	if (doc == stream.end()) { return false; }
+	auto *entries = dyn_cast_or_null<yaml::SequenceNode>(doc->getRoot());
+	if (!entries) {
+		errs() << filename << ": expected an array of compile commands\n";
+		return false;
+	}
+
+	for (yaml::Node& node: *entries) {
+		auto *entry = dyn_cast<yaml::MappingNode>(&node);
+		if (!entry) { continue; }
+
+		CompileCommand command;
+		for (yaml::KeyValueNode& kv: *entry) {
+			auto *key = dyn_cast_or_null<yaml::ScalarNode>(kv.getKey());
+			if (!key) { continue; }
+			SmallString<32> keystorage;
+			StringRef name = key->getValue(keystorage);
+
+			if (auto *args = dyn_cast_or_null<yaml::SequenceNode>(kv.getValue())) {
+				if (name != "arguments") { continue; }
+				for (yaml::Node& arg: *args) {
+					auto *scalar = dyn_cast<yaml::ScalarNode>(&arg);
+					SmallString<64> storage;
+					if (scalar) { command.arguments.push_back(scalar->getValue(storage).str()); }
+				}
+				continue;
+			}
+
+			auto *value = dyn_cast_or_null<yaml::ScalarNode>(kv.getValue());
+			if (!value) { continue; }
+			SmallString<256> storage;
+			StringRef text = value->getValue(storage);
+			if (name == "directory") { command.directory = text.str(); }
+			if (name == "file")      { command.file = text.str(); }
+			if (name == "command" && command.arguments.empty()) { command.arguments = splitCommandLine(text); }
+		}
+
+		if (command.file.empty() || command.arguments.empty()) { continue; }
+		commands.push_back(command);
+	}
+
+	if (stream.failed()) { return false; }
+	return true;
+}
+
+// original command line with output / compile-only / dependency flags removed. Bitcode with debug
+// info and without optimizations is requested instead, as analysis expects locals to live in memory.
+// Dependency files written next to the bitcode would overwrite the ones of the real build, and
+// -M / -MM would replace compilation altogether.
+static std::vector<std::string> getBitcodeArguments(const CompileCommand& command, const std::string& clang,
+													const std::string& output) {
+	std::vector<std::string> out;
+	out.push_back(clang);
+	for (unsigned i = 1; i < command.arguments.size(); i++) {
+		StringRef arg = command.arguments[i];
+		if (arg == "-o") { i++; continue; }
+		if (arg.startswith("-o") || arg == "-c" || arg == "-S" || arg == "-E") { continue; }
+		if (arg == "-MF" || arg == "-MT" || arg == "-MQ" || arg == "-MJ") { i++; continue; }
+		if (arg.startswith("-M")) { continue; }
+		out.push_back(arg.str());
+	}
+	out.push_back("-working-directory");
+	out.push_back(command.directory);
+	out.push_back("-c");
+	out.push_back("-emit-llvm");
+	out.push_back("-O0");
+	out.push_back("-g");
+	out.push_back("-o");
+	out.push_back(output);
+	return out;
+}
+
+// translation units may define functions with the same name, so per-region files of each one
+// start with its absolute source path, e.g. /work/src/util.c gives work_src_util_c__main_forcond_forend.xml.
+static std::string getFilePrefix(const CompileCommand& command) {
+	SmallString<128> path(command.file);
+	sys::fs::make_absolute(command.directory, path);
+	sys::path::remove_dots(path, true);
+	std::string prefix = sys::path::relative_path(path).str();
+	for (char& c: prefix) {
+		if (!isalnum(static_cast<unsigned char>(c))) { c = '_'; }
+	}
+	return prefix + "__";
+}
+
+static void processCommand(const CompileCommand& command, const std::string& clang, 
+						   const std::shared_ptr<const funcextract::RegionList>& regionlist) {
+	SmallString<128> bitcode;
+	if (std::error_code EC = sys::fs::createTemporaryFile("funcextract", "bc", bitcode)) {
+		std::lock_guard<std::mutex> guard(errorlock);
+		errs() << "Could not create temporary file: " << EC.message() << "\n";
+		return;
+	}
+
+	std::vector<std::string> args = getBitcodeArguments(command, clang, bitcode.str().str());
+	std::vector<const char *> argv;
+	for (std::string& arg: args) { argv.push_back(arg.c_str()); }
+	argv.push_back(nullptr);
+
+	std::string errmsg;
+	int status = sys::ExecuteAndWait(clang, argv.data(), nullptr, nullptr, 0, 0, &errmsg);
+	if (status != 0) {
+		std::lock_guard<std::mutex> guard(errorlock);
+		errs() << "Compiling " << command.file << " failed" << (errmsg.empty() ? "" : ": ") << errmsg << ", skipping...\n";
+		sys::fs::remove(bitcode);
+		return;
+	}
+
+	// every translation unit gets its own context, so modules can be analysed side by side.
+	LLVMContext context;
+	SMDiagnostic err;
+	std::unique_ptr<Module> M = getLazyIRFileModule(bitcode, err, context);
+	if (M) {
+		funcextract::RegionListExtractor extractor(regionlist);
+		extractor.setFilePrefix(getFilePrefix(command));
+		extractor.extractLazyModule(*M);
+	} else {
+		std::lock_guard<std::mutex> guard(errorlock);
+		err.print(command.file.c_str(), errs());
+	}
+	sys::fs::remove(bitcode);
+}
+
+int main(int argc, char **argv) {
+	sys::PrintStackTraceOnErrorSignal(argv[0]);
+	PrettyStackTraceProgram X(argc, argv);
+	llvm_shutdown_obj Y;
+	cl::ParseCommandLineOptions(argc, argv, "writes region info for every translation unit of a project\n");
+
+	std::vector<CompileCommand> commands;
+	if (!parseCompileCommands(CompileCommands, commands)) { return 1; }
+
+	// a file built more than once (e.g. for several targets) would write the same files twice.
+	std::set<std::string> prefixes;
+	auto duplicate = [&](const CompileCommand& command) {
+		if (prefixes.insert(getFilePrefix(command)).second) { return false; }
+		errs() << command.file << " is listed more than once, skipping...\n";
+		return true;
+	};
+	commands.erase(std::remove_if(commands.begin(), commands.end(), duplicate), commands.end());
+
+	std::string clang = ClangPath;
+	if (!sys::path::has_parent_path(clang)) {
+		ErrorOr<std::string> found = sys::findProgramByName(clang);
+		if (!found) {
+			errs() << "Could not find " << clang << " in PATH\n";
+			return 1;
+		}
+		clang = *found;
+	}
+
+	unsigned numthreads = Jobs;
+	if (numthreads == 0) { numthreads = std::max(1u, std::thread::hardware_concurrency()); }
+	numthreads = std::min<unsigned>(numthreads, std::max<size_t>(1, commands.size()));
+
+	// region list is the same for every translation unit, read it once.
+	std::shared_ptr<const funcextract::RegionList> regionlist(new funcextract::RegionList());
+
+	std::atomic<unsigned> next(0);
+	auto worker = [&]() {
+		for (unsigned i = next++; i < commands.size(); i = next++) { processCommand(commands[i], clang, regionlist); }
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned i = 1; i < numthreads; i++) { threads.push_back(std::thread(worker)); }
+	worker();
+	for (std::thread& t: threads) { t.join(); }
+	return 0;
+}
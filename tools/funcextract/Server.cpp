@@ -0,0 +1,204 @@
+// server mode of funcextract. Keeps modules in memory and answers region queries over a unix
+// socket, one line per request:
+//
+//   load <file>                           (re)loads bitcode or textual IR file.
+//   query <function> <start> <end> <file> record of the smallest region covering the lines.
+//   shutdown                              stops the server.
+//
+// Every response starts with a header line, either "ok <size>" followed by <size> bytes of
+// payload, or "error <message>". Query payload is the region record in -funcextract-format.
+//
+// When a file is loaded again, answers for functions whose fingerprint did not change are kept,
+// everything else is computed again on the next query. Analysis state of the analyzer refers to
+// values of the old module, so it is not carried over, only the answers are.
+#include "Server.h"
+#include "FuncExtract.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include <map>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace llvm;
+
+namespace {
+	// answers computed for a function while its fingerprint stays the same.
+	struct FunctionAnswers {
+		std::string fingerprint;
+		std::map<std::pair<unsigned, unsigned>, std::string> records; // lines -> record.
+	};
+
+	struct LoadedModule {
+		std::unique_ptr<LLVMContext> context; // own context per file, so reloads free the old types and constants.
+		std::unique_ptr<Module> M;
+		std::unique_ptr<funcextract::ModuleAnalyzer> analyzer; // must go before the module.
+		StringMap<FunctionAnswers> answers;
+	};
+
+	struct Server {
+		StringMap<LoadedModule> modules;
+		bool running = true;
+
+		std::string load(StringRef, raw_ostream&);
+		std::string query(StringRef, unsigned, unsigned, StringRef, raw_ostream&);
+		std::string handle(StringRef, raw_ostream&);
+	};
+}
+
+static bool readLine(int, std::string&, std::string&);
+static bool writeAll(int, StringRef);
+
+// returns error message, empty on success.
+std::string Server::load(StringRef filename, raw_ostream& out) {
+	SMDiagnostic err;
+	std::unique_ptr<LLVMContext> context(new LLVMContext);
+	std::unique_ptr<Module> M = parseIRFile(filename, err, *context);
+	if (!M) { return "could not read " + filename.str() + ": " + err.getMessage().str(); }
+
+	LoadedModule& loaded = modules[filename];
+	std::unique_ptr<funcextract::ModuleAnalyzer> analyzer(new funcextract::ModuleAnalyzer(*M));
+
+	// keep answers of functions that did not change, drop the rest.
+	StringMap<FunctionAnswers> answers;
+	unsigned total = 0, changed = 0;
+	for (Function& F: *M) {
+		if (F.isDeclaration()) { continue; }
+		total++;
+		FunctionAnswers& current = answers[F.getName()];
+		current.fingerprint = analyzer->getFingerprint(F);
+		auto it = loaded.answers.find(F.getName());
+		if (it != loaded.answers.end() && it->getValue().fingerprint == current.fingerprint) {
+			current.records = std::move(it->getValue().records);
+			continue;
+		}
+		changed++;
+	}
+
+	// old analyzer, module and context are released in this order.
+	loaded.analyzer = std::move(analyzer);
+	loaded.M = std::move(M);
+	loaded.context = std::move(context);
+	loaded.answers = std::move(answers);
+	out << "functions " << total << " changed " << changed << "\n";
+	return "";
+}
+
+std::string Server::query(StringRef function, unsigned start, unsigned end, StringRef filename, raw_ostream& out) {
+	auto it = modules.find(filename);
+	if (it == modules.end()) { return "file not loaded"; }
+	LoadedModule& loaded = it->getValue();
+
+	Function *F = loaded.M->getFunction(function);
+	auto answer = loaded.answers.find(function);
+	if (!F || answer == loaded.answers.end()) { return "no such function"; }
+
+	std::map<std::pair<unsigned, unsigned>, std::string>& records = answer->getValue().records;
+	auto cached = records.find(std::make_pair(start, end));
+	if (cached != records.end()) {
+		out << cached->second;
+		return "";
+	}
+
+	std::string record;
+	raw_string_ostream recordstream(record);
+	if (!loaded.analyzer->writeRegionForLines(*F, start, end, recordstream)) { return "no region covers given lines"; }
+	out << recordstream.str();
+	records[std::make_pair(start, end)] = record;
+	return "";
+}
+
+std::string Server::handle(StringRef line, raw_ostream& out) {
+	std::pair<StringRef, StringRef> command = line.trim().split(' ');
+	if (command.first == "shutdown") {
+		running = false;
+		return "";
+	}
+	if (command.first == "load") { return load(command.second.trim(), out); }
+	if (command.first == "query") {
+		std::pair<StringRef, StringRef> function = command.second.trim().split(' ');
+		std::pair<StringRef, StringRef> start = function.second.trim().split(' ');
+		std::pair<StringRef, StringRef> end = start.second.trim().split(' ');
+		unsigned startline, endline;
+		if (start.first.getAsInteger(10, startline) || end.first.getAsInteger(10, endline) || end.second.trim().empty()) {
+			return "usage: query <function> <start> <end> <file>";
+		}
+		return query(function.first, startline, endline, end.second.trim(), out);
+	}
+	return "unknown command";
+}
+
+// reads one line from the socket, buffer keeps whatever came after it.
+static bool readLine(int fd, std::string& buffer, std::string& line) {
+	while (true) {
+		size_t newline = buffer.find('\n');
+		if (newline != std::string::npos) {
+			line = buffer.substr(0, newline);
+			buffer.erase(0, newline + 1);
+			return true;
+		}
+
+		char chunk[4096];
+		ssize_t n = read(fd, chunk, sizeof(chunk));
+		if (n <= 0) { return false; }
+		buffer.append(chunk, n);
+	}
+}
+
+static bool writeAll(int fd, StringRef data) {
+	while (!data.empty()) {
+		ssize_t n = write(fd, data.data(), data.size());
+		if (n <= 0) { return false; }
+		data = data.drop_front(n);
+	}
+	return true;
+}
+
+int serve(const std::string& socketpath) {
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (socketpath.size() >= sizeof(address.sun_path)) {
+		errs() << "Socket path is too long\n";
+		return 1;
+	}
+	socketpath.copy(address.sun_path, socketpath.size());
+
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	unlink(socketpath.c_str());
+	if (listener < 0 || bind(listener, (sockaddr *)&address, sizeof(address)) < 0 || listen(listener, 8) < 0) {
+		errs() << "Could not listen on " << socketpath << "\n";
+		return 1;
+	}
+
+	// requests are answered one at a time, clients are expected to be few and short.
+	Server server;
+	while (server.running) {
+		int client = accept(listener, nullptr, nullptr);
+		if (client < 0) { continue; }
+
+		std::string buffer, line;
+		while (server.running && readLine(client, buffer, line)) {
+			std::string payload;
+			raw_string_ostream out(payload);
+			std::string error = server.handle(line, out);
+			out.flush();
+
+			SmallString<64> header;
+			raw_svector_ostream headerstream(header);
+			if (error.empty()) { headerstream << "ok " << payload.size() << "\n"; }
+			else { headerstream << "error " << error << "\n"; payload.clear(); }
+			if (!writeAll(client, header) || !writeAll(client, payload)) { break; }
+		}
+		close(client);
+	}
+
+	close(listener);
+	unlink(socketpath.c_str());
+	return 0;
+}
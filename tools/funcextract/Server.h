@@ -0,0 +1,9 @@
+#ifndef FUNCEXTRACT_SERVER_H
+#define FUNCEXTRACT_SERVER_H
+
+#include <string>
+
+// serves region queries over a unix socket until told to shut down. Returns exit code.
+int serve(const std::string& socketpath);
+
+#endif
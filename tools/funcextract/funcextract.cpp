@@ -0,0 +1,53 @@
+// standalone version of -funcextract-module. Reads bitcode lazily and only materializes
+// functions from the region list, so the cost of a run depends on the number of listed
+// functions rather than the size of the module. With -serve it runs as a server instead,
+// see Server.cpp.
+#include "FuncExtract.h"
+#include "Server.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+static cl::opt<std::string> InputFilename(cl::Positional,
+			cl::desc("<input bitcode file>"), cl::Optional);
+
+static cl::opt<std::string> SocketPath("serve",
+			cl::desc("Answer region queries on given unix socket instead of processing a single file."),
+			cl::value_desc("socket"), cl::init(""));
+
+int main(int argc, char **argv) {
+	sys::PrintStackTraceOnErrorSignal(argv[0]);
+	PrettyStackTraceProgram X(argc, argv);
+	llvm_shutdown_obj Y;
+
+	// region list and output are not needed in server mode, check them ourselves.
+	StringMap<cl::Option *>& options = cl::getRegisteredOptions();
+	options["bblist"]->setNumOccurrencesFlag(cl::Optional);
+	options["out"]->setNumOccurrencesFlag(cl::Optional);
+	cl::ParseCommandLineOptions(argc, argv, "writes region info for the extractor script\n");
+
+	if (!SocketPath.empty()) { return serve(SocketPath); }
+	if (InputFilename.empty() || options["bblist"]->getNumOccurrences() == 0 || options["out"]->getNumOccurrences() == 0) {
+		errs() << argv[0] << ": input file, --bblist and --out are required\n";
+		return 1;
+	}
+
+	LLVMContext context;
+	SMDiagnostic err;
+	std::unique_ptr<Module> M = getLazyIRFileModule(InputFilename, err, context);
+	if (!M) {
+		err.print(argv[0], errs());
+		return 1;
+	}
+
+	funcextract::RegionListExtractor extractor;
+	return extractor.extractLazyModule(*M) ? 0 : 1;
+}